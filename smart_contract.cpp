@@ -4,6 +4,14 @@
 
 using namespace eosio;
 
+// Les traces de diagnostic ne sont compilées qu'avec -DMYCONTRACT_DEBUG ;
+// la version de production n'exécute aucun print.
+#ifdef MYCONTRACT_DEBUG
+#define DEBUG_PRINT(...) eosio::print(__VA_ARGS__)
+#else
+#define DEBUG_PRINT(...)
+#endif
+
 CONTRACT mycontract : public contract {
 public:
     using contract::contract;
@@ -66,7 +74,7 @@ public:
       uint64_t target_attack_points;
       asset reward;
       bool is_completed = false;
-      uint64_t total_attack_points = 0;
+      uint64_t total_attack_points = 0; // Points reportés au dernier rééquilibrage des fractions
       uint64_t last_hardening_time; // Ajout pour suivre le dernier durcissement
       bool is_distributed = false;
       time_point_sec deadline; // Ajout du membre 'deadline'
@@ -76,6 +84,21 @@ public:
 
 
 
+   // Fractions des points d'attaque d'une mission (scope = nom de la mission), pour que
+   // les attaques simultanées n'écrivent pas toutes la même ligne de mission. Chaque
+   // fraction reçoit un quota du reste à atteindre ; une attaque n'écrit que sa fraction
+   // tant que le quota suffit. Les fractions sont reportées dans total_attack_points et
+   // les quotas redistribués quand l'une d'elles est épuisée. Quand les quotas seraient
+   // trop petits (petite cible, fin de mission), il n'y a pas de fractions et chaque
+   // attaque écrit directement la mission.
+   TABLE attack_shard_struct {
+      uint64_t shard;         // Numéro de fraction, choisi par hachage du joueur
+      uint64_t attack_points; // Points d'attaque pas encore reportés dans la mission
+      uint64_t quota;         // Points d'attaque encore acceptés par cette fraction
+
+      uint64_t primary_key() const { return shard; }
+   };
+
    TABLE player_mission_struct {
       uint64_t id; // Clé primaire unique
       name mission_name;
@@ -94,6 +117,18 @@ public:
       uint64_t primary_key() const { return player_name.value; }
    };
 
+   // File des nettoyages en cascade à effectuer après la suppression d'un owner ou d'un player.
+   // Dans la scope d'une mission, une ligne désigne la participation (cursor = id dans
+   // playermiss) d'un compte supprimé, conservée jusqu'à la distribution des récompenses.
+   TABLE purge_struct {
+      name account;    // Compte supprimé dont les lignes dépendantes restent à nettoyer
+      uint8_t roles;   // Rôles retirés au compte (PURGE_OWNER, PURGE_PLAYER)
+      uint8_t stage;   // Étape en cours (PURGE_SUPPORTS, PURGE_PARTICIPATION)
+      uint64_t cursor; // Clé primaire à partir de laquelle reprendre l'étape en cours
+
+      uint64_t primary_key() const { return account.value; }
+   };
+
 
    typedef multi_index<"members"_n, member_struct> member_table;
    typedef eosio::multi_index<"playermiss"_n, player_mission_struct,
@@ -101,11 +136,72 @@ public:
       indexed_by<"bymission"_n, const_mem_fun<player_mission_struct, uint64_t, &player_mission_struct::by_mission>>
    > player_missions_table;
     typedef eosio::multi_index<"missions"_n, mission_struct> missions_table;
+    typedef multi_index<"attackshards"_n, attack_shard_struct> attack_shards_table;
     typedef multi_index<"owners"_n, owner_struct> owners_table;
     typedef multi_index<"players"_n, player_struct> players_table;
     typedef multi_index<"supports"_n, support_struct> supports_table;
     typedef multi_index<"forge"_n, forge_struct> forge_table;
     typedef multi_index<"chests"_n, chest_struct> chests_table;
+    typedef multi_index<"purges"_n, purge_struct> purges_table;
+
+   // Étapes du nettoyage en cascade
+   static constexpr uint8_t PURGE_SUPPORTS = 0;
+   static constexpr uint8_t PURGE_PARTICIPATION = 1;
+
+   // Rôles retirés à un compte en attente de nettoyage
+   static constexpr uint8_t PURGE_OWNER = 1;
+   static constexpr uint8_t PURGE_PLAYER = 2;
+
+   // Nombre de fractions de points d'attaque par mission
+   static constexpr uint64_t ATTACK_SHARDS = 8;
+
+   // Version du format des pages d'export, à incrémenter à chaque changement de structure d'une table
+   static constexpr uint32_t EXPORT_SCHEMA_VERSION = 1;
+
+   // Nombre maximal de lignes par page d'export
+   static constexpr uint32_t EXPORT_MAX_ROWS = 500;
+
+   // Nombre maximal de lignes parcourues par le nettoyage lancé depuis removeland, removelands et removeplayer
+   static constexpr uint32_t INLINE_PURGE_BUDGET = 50;
+
+   // Tables partagées pendant toute une action : les helpers et les boucles de lot
+   // réutilisent les mêmes handles, donc le cache d'objets de multi_index,
+   // au lieu de relire les mêmes lignes à chaque élément.
+   struct action_context {
+      owners_table owners;
+      players_table players;
+      supports_table supports;
+      forge_table forge;
+
+      // batch : action de lot où un même compte peut être recherché plusieurs fois
+      explicit action_context(name self, bool batch = false)
+         : owners(self, self.value), players(self, self.value), supports(self, self.value), forge(self, self.value),
+           memoize_forge_misses(batch) {}
+
+      // Appartenance à la forge. Un membre trouvé reste dans le cache d'objets de multi_index ;
+      // seules les absences sont mémorisées, et seulement dans les actions de lot.
+      bool in_forge(name account) {
+         if (memoize_forge_misses && std::binary_search(forge_misses.begin(), forge_misses.end(), account.value)) return false;
+         if (forge.find(account.value) != forge.end()) return true;
+
+         if (memoize_forge_misses) {
+            forge_misses.insert(std::upper_bound(forge_misses.begin(), forge_misses.end(), account.value), account.value);
+         }
+         return false;
+      }
+
+      void add_to_forge(name payer, name player) {
+         forge.emplace(payer, [&](auto& row) {
+            row.player_address = player;
+         });
+         auto miss = std::lower_bound(forge_misses.begin(), forge_misses.end(), player.value);
+         if (miss != forge_misses.end() && *miss == player.value) forge_misses.erase(miss);
+      }
+
+   private:
+      bool memoize_forge_misses;
+      std::vector<uint64_t> forge_misses; // Comptes absents de la forge, triés
+   };
 
    struct OwnerDetails {
       name owner; 
@@ -118,10 +214,11 @@ public:
       // Pas besoin de numberofland ici, car il est dérivé du nombre d'éléments dans land_ids
    };
 
-   ACTION addowners(std::vector<OwnerDetails> owner_details) {
+   ACTION addowners(const std::vector<OwnerDetails>& owner_details) {
     require_auth(get_self());
 
-    owners_table _owners(get_self(), get_self().value);
+    action_context ctx(get_self(), true);
+    auto& _owners = ctx.owners;
 
     for (const auto& detail : owner_details) {
         auto owner_itr = _owners.find(detail.owner.value);
@@ -155,7 +252,7 @@ public:
         }
 
         // Appeler upsupport pour chaque propriétaire mis à jour
-        upsupport(detail.owner);
+        upsupport(ctx, detail.owner);
     }
 }
 
@@ -164,7 +261,8 @@ public:
                      std::optional<uint64_t> totalAttack, std::optional<uint64_t> totalAttackArm, std::optional<uint64_t> totalMoveCost) {
       require_auth(get_self());
 
-      owners_table owners(get_self(), get_self().value);
+      action_context ctx(get_self());
+      auto& owners = ctx.owners;
       auto it = owners.find(owner.value);
 
       // Si le propriétaire n'existe pas, on l'ajoute
@@ -196,7 +294,7 @@ public:
                if (totalMoveCost.has_value()) row.totalMoveCost = totalMoveCost.value();
          });
       }
-      upsupport(owner); // Mettre à jour les supports associés au propriétaire
+      upsupport(ctx, owner); // Mettre à jour les supports associés au propriétaire
    }
 
 
@@ -204,20 +302,50 @@ public:
    ACTION removeland(name owner, uint64_t land_id) {
       require_auth(get_self());
 
-      owners_table owners(get_self(), get_self().value);
-      auto it = owners.find(owner.value);
-      check(it != owners.end(), "Owner not found");
+      action_context ctx(get_self());
+      remove_land(ctx, owner, land_id);
+      run_purges(ctx, INLINE_PURGE_BUDGET);
+   }
 
-      owners.modify(it, get_self(), [&](auto& row) {
-         auto itr = std::find(row.land_ids.begin(), row.land_ids.end(), land_id);
-         check(itr != row.land_ids.end(), "Land not found for this owner");
-         row.land_ids.erase(itr);
+   struct LandRemoval {
+      name owner;
+      uint64_t land_id;
+   };
 
-         // Si le propriétaire n'a plus de terrain, le supprimer de la table
-         if (row.land_ids.empty()) {
-               it = owners.erase(it);
-         }
-      });
+   // Action pour retirer plusieurs terrains en une seule transaction
+   ACTION removelands(const std::vector<LandRemoval>& lands) {
+      require_auth(get_self());
+
+      action_context ctx(get_self(), true);
+      for (const auto& land : lands) {
+         remove_land(ctx, land.owner, land.land_id);
+      }
+      run_purges(ctx, INLINE_PURGE_BUDGET);
+   }
+
+   // Action pour supprimer un joueur et ses lignes dépendantes
+   ACTION removeplayer(name player) {
+      require_auth(get_self());
+
+      action_context ctx(get_self());
+      auto itr = ctx.players.find(player.value);
+      check(itr != ctx.players.end(), "Player not found");
+      ctx.players.erase(itr);
+
+      queue_purge(player, PURGE_PLAYER);
+      run_purges(ctx, INLINE_PURGE_BUDGET);
+   }
+
+   // Poursuit les nettoyages en attente en parcourant au plus max_rows lignes
+   ACTION purge(uint32_t max_rows) {
+      require_auth(get_self());
+      check(max_rows > 0, "max_rows must be positive");
+
+      purges_table purges(get_self(), get_self().value);
+      check(purges.begin() != purges.end(), "Nothing to purge");
+
+      action_context ctx(get_self(), true);
+      run_purges(ctx, max_rows);
    }
 
       struct  PlayerDetails {
@@ -232,7 +360,8 @@ public:
    ACTION addplayers(const std::vector<PlayerDetails>& players_details) {
       require_auth(get_self());
 
-      players_table _players(get_self(), get_self().value);
+      action_context ctx(get_self(), true);
+      auto& _players = ctx.players;
 
       for (const auto& details : players_details) {
          auto itr = _players.find(details.player_address.value);
@@ -258,7 +387,7 @@ public:
             });
          }
          // Appeler la fonction upsupport pour chaque joueur mis à jour
-         upsupport(details.player_address);
+         upsupport(ctx, details.player_address);
       }
    }
 
@@ -269,7 +398,8 @@ public:
                            uint64_t totalAttack, uint64_t totalAttackArm, uint64_t totalMoveCost) {
       require_auth(get_self());
 
-      players_table players(get_self(), get_self().value);
+      action_context ctx(get_self());
+      auto& players = ctx.players;
       auto itr = players.find(player_address.value);
 
       if (itr == players.end()) {
@@ -292,7 +422,7 @@ public:
                row.totalMoveCost = totalMoveCost;
          });
       }
-      upsupport(player_address);
+      upsupport(ctx, player_address);
    }
 
 
@@ -338,13 +468,15 @@ public:
    ACTION addsupport(name player, name new_owner) {
       require_auth(player);
 
+      action_context ctx(get_self());
+
       // Vérifier si le nouveau propriétaire existe
-      owners_table owners(get_self(), get_self().value);
+      auto& owners = ctx.owners;
       auto new_owner_itr = owners.find(new_owner.value);
       check(new_owner_itr != owners.end(), "New owner not found");
 
       // Récupérer les informations du joueur
-      players_table players(get_self(), get_self().value);
+      auto& players = ctx.players;
       auto player_itr = players.find(player.value);
       check(player_itr != players.end(), "Player not found");
 
@@ -352,9 +484,7 @@ public:
       check(new_owner_itr->owner_address != player, "Owner cannot support itself");
 
       // Vérifier si le joueur est dans la forge
-      forge_table forge(get_self(), get_self().value);
-      auto forge_itr = forge.find(player.value);
-      bool in_forge = forge_itr != forge.end();
+      bool in_forge = ctx.in_forge(player);
 
       // Calculer les scores du joueur en fonction de s'il est dans la forge ou non
       uint64_t player_defense_score = in_forge ? player_itr->totalDefenseArm : player_itr->totalDefense;
@@ -362,7 +492,7 @@ public:
       uint64_t player_move_cost = player_itr->totalMoveCost;
 
       // Récupérer la table des soutiens
-      supports_table supports(get_self(), get_self().value);
+      auto& supports = ctx.supports;
 
       // Retirer le joueur des soutiens de l'ancien propriétaire
       for (auto& support : supports) {
@@ -422,7 +552,7 @@ public:
          new_mission.deadline = time_point_sec(mission_deadline); // Utilisez time_point_sec pour définir la date limite
       });
 
-      print("Mission créée : ", mission_name, " - Points d'attaque cible : ", target_attack_points, " - Récompense : ", reward, " - Date limite : ", mission_deadline);
+      DEBUG_PRINT("Mission créée : ", mission_name, " - Points d'attaque cible : ", target_attack_points, " - Récompense : ", reward, " - Date limite : ", mission_deadline);
    }
 
    ACTION hardenmiss() {
@@ -470,21 +600,18 @@ public:
       bool is_in_forge = false;
       
       // Vérifier si le joueur est dans la forge
-      forge_table forges(get_self(), get_self().value);
-      auto existing_forge = forges.find(player.value);
-      if(existing_forge != forges.end()) {
-         is_in_forge = true;
-      }
+      action_context ctx(get_self());
+      is_in_forge = ctx.in_forge(player);
 
       // Vérifier si le joueur est un propriétaire
-      owners_table owners(get_self(), get_self().value);
+      auto& owners = ctx.owners;
       auto existing_owner = owners.find(player.value);
       if (existing_owner != owners.end()) {
          attack_points = is_in_forge ? existing_owner->totalAttackArm : existing_owner->totalAttack;
          move_cost = existing_owner->totalMoveCost;
       } else {
          // Sinon, vérifier si le joueur est un joueur ordinaire
-         players_table players(get_self(), get_self().value);
+         auto& players = ctx.players;
          auto existing_player = players.find(player.value);
          if (existing_player != players.end()) {
                attack_points = is_in_forge ? existing_player->totalAttackArm : existing_player->totalAttack;
@@ -494,33 +621,46 @@ public:
 
       check(attack_points > 0, "Les points d'attaque doivent être supérieurs à zéro.");
 
-      // Calculer les points d'attaque utiles
-      uint64_t useful_attack_points = std::min(attack_points, existing_mission->target_attack_points - existing_mission->total_attack_points);
-
       // Calculer la période de refroidissement
       uint64_t cooldown_period = 24 * 3600 + (move_cost / 100);
 
-      // Trouver ou créer l'entrée correspondante dans la table player_missions
-      bool entry_found = false;
+      // Trouver l'entrée du joueur pour cette mission et vérifier le cooldown
+      auto entry_itr = player_index.end();
       for (; player_mission_itr != player_index.end() && player_mission_itr->player == player; ++player_mission_itr) {
          if (player_mission_itr->mission_name == mission_name) {
-               entry_found = true;
-               // Vérifier si le cooldown est respecté
+               // Le message d'erreur n'est construit qu'en cas d'échec
                uint64_t time_since_last_attack = current_time_seconds - player_mission_itr->last_participation_time;
-               uint64_t remaining_cooldown = cooldown_period > time_since_last_attack ? cooldown_period - time_since_last_attack : 0;
-
-               check(time_since_last_attack >= cooldown_period, "Vous devez attendre " + std::to_string(remaining_cooldown) + " secondes avant de participer à nouveau.");
-
-               // Mettre à jour l'entrée existante
-               player_index.modify(player_mission_itr, get_self(), [&](auto& mod_player_mission) {
-                  mod_player_mission.last_participation_time = current_time_seconds;
-                  mod_player_mission.attack_points += useful_attack_points;
-               });
+               if (time_since_last_attack < cooldown_period) {
+                  uint64_t remaining_cooldown = cooldown_period - time_since_last_attack;
+                  check(false, "Vous devez attendre " + std::to_string(remaining_cooldown) + " secondes avant de participer à nouveau.");
+               }
+               entry_itr = player_mission_itr;
                break;
          }
       }
 
-      if (!entry_found) {
+      // Tant que le quota de sa fraction suffit, l'attaque n'écrit que cette fraction ;
+      // sinon les fractions sont rééquilibrées, ce qui calcule les points utiles exacts.
+      // Les fractions existent toutes ou aucune : sans la sienne, il n'y en a pas.
+      attack_shards_table shards(get_self(), mission_name.value);
+      auto shard_itr = shards.find(attack_shard_of(player));
+      uint64_t useful_attack_points = attack_points;
+      if (shard_itr != shards.end() && attack_points < shard_itr->quota) {
+         shards.modify(shard_itr, get_self(), [&](auto& mod_shard) {
+            mod_shard.attack_points += attack_points;
+            mod_shard.quota -= attack_points;
+         });
+      } else {
+         useful_attack_points = rebalance_attack_shards(missions, existing_mission, shards, shard_itr != shards.end(), attack_points);
+      }
+
+      if (entry_itr != player_index.end()) {
+         // Mettre à jour l'entrée existante
+         player_index.modify(entry_itr, get_self(), [&](auto& mod_player_mission) {
+               mod_player_mission.last_participation_time = current_time_seconds;
+               mod_player_mission.attack_points += useful_attack_points;
+         });
+      } else {
          // Créer une nouvelle entrée si le joueur n'a pas encore attaqué cette mission
          player_missions.emplace(get_self(), [&](auto& new_player_mission) {
                new_player_mission.id = player_missions.available_primary_key();
@@ -531,18 +671,8 @@ public:
          });
       }
 
-
-      // Mettre à jour les points d'attaque totaux pour la mission
-      missions.modify(existing_mission, get_self(), [&](auto& mod_mission) {
-         mod_mission.total_attack_points += useful_attack_points;
-         if (mod_mission.total_attack_points >= mod_mission.target_attack_points) {
-               mod_mission.is_completed = true;
-               // Logique supplémentaire si la mission est complétée (par exemple, distribuer des récompenses)
-         }
-      });
-
       // Informer l'utilisateur de l'attaque réussie
-      print("Attaque envoyée par le joueur ", player, " pour la mission ", mission_name);
+      DEBUG_PRINT("Attaque envoyée par le joueur ", player, " pour la mission ", mission_name);
    }
 
    ACTION distributere(name mission_name) {
@@ -553,6 +683,8 @@ public:
       check(mission_itr != missions.end(), "Mission does not exist.");
       check(mission_itr->is_completed, "Mission is not yet completed.");
       check(!mission_itr->is_distributed, "Rewards have already been distributed for this mission.");
+
+      // Une mission complétée n'a plus de fractions : son total est à jour
       check(mission_itr->total_attack_points > 0, "Total attack points must be positive.");
 
       player_missions_table player_missions(_self, _self.value);
@@ -561,6 +693,9 @@ public:
       auto upper = mission_index.upper_bound(mission_name.value);
       int64_t rewards_distributed = 0;
 
+      // Mémo commun à tous les transferts, construit une seule fois
+      const std::string memo = "Mission reward: " + mission_name.to_string();
+
       for (auto it = lower; it != upper; ++it) {
          check(it->attack_points > 0, "Player attack points must be positive.");
          double player_ratio = static_cast<double>(it->attack_points) / static_cast<double>(mission_itr->total_attack_points);
@@ -573,10 +708,26 @@ public:
          action(
                permission_level{get_self(), "active"_n},
                "alien.worlds"_n, "transfer"_n,
-               std::make_tuple(get_self(), it->player, player_reward, "Mission reward: " + mission_name.to_string())
+               std::forward_as_tuple(get_self(), it->player, player_reward, memo)
          ).send();
       }
 
+      // Une fois payées, les participations laissées par le nettoyage de comptes supprimés
+      // ne servent plus, sauf si le compte est redevenu owner ou player
+      purges_table removed(get_self(), mission_name.value);
+      if (removed.begin() != removed.end()) {
+         action_context ctx(get_self());
+         for (auto itr = removed.begin(); itr != removed.end(); itr = removed.erase(itr)) {
+            name account = itr->account;
+            if (ctx.owners.find(account.value) != ctx.owners.end() || ctx.players.find(account.value) != ctx.players.end()) continue;
+
+            auto participation_itr = player_missions.find(itr->cursor);
+            if (participation_itr != player_missions.end() && participation_itr->player == account) {
+               player_missions.erase(participation_itr);
+            }
+         }
+      }
+
       // Update the mission to indicate that the rewards have been distributed.
       missions.modify(mission_itr, get_self(), [&](auto& mod_mission) {
          mod_mission.is_distributed = true;
@@ -589,36 +740,73 @@ public:
     require_auth(get_self());
 
     // Vérifier si le joueur est déjà dans la forge
-    forge_table forge(get_self(), get_self().value);
-    auto itr = forge.find(player.value);
-    check(itr == forge.end(), "Player already in forge");
+    action_context ctx(get_self());
+    check(!ctx.in_forge(player), "Player already in forge");
 
     // Ajouter le joueur à la forge
-    forge.emplace(get_self(), [&](auto& row) {
-        row.player_address = player;
-    });
+    ctx.add_to_forge(get_self(), player);
 
     // Mettre à jour les soutiens
-    upsupport(player);
+    upsupport(ctx, player);
 }
 
+   // Page d'export : lignes d'une table sérialisées bout à bout, dans leur format binaire de stockage
+   struct export_page {
+      uint32_t schema_version; // EXPORT_SCHEMA_VERSION au moment de l'export
+      name table;
+      name scope;
+      uint32_t row_count;
+      bool more;               // D'autres lignes restent à lire à partir de next_cursor
+      uint64_t next_cursor;    // Clé primaire à passer comme cursor pour la page suivante
+      std::vector<char> rows;
+   };
+
+   // Export en lecture seule d'une page de table, à partir de la clé primaire cursor.
+   // Une scope vide désigne le contrat ; attackshards et les participations en attente
+   // de purges sont indexées par nom de mission.
+   [[eosio::action, eosio::read_only]] export_page exportpage(name table, name scope, uint64_t cursor, uint32_t limit) {
+      // Le message n'est construit qu'en cas d'échec
+      if (limit == 0 || limit > EXPORT_MAX_ROWS) {
+         check(false, "limit must be between 1 and " + std::to_string(EXPORT_MAX_ROWS));
+      }
+
+      export_page page{};
+      page.schema_version = EXPORT_SCHEMA_VERSION;
+      page.table = table;
+      page.scope = scope.value == 0 ? get_self() : scope;
+
+      switch (table.value) {
+         case "owners"_n.value:       export_rows(owners_table(get_self(), page.scope.value), cursor, limit, page); break;
+         case "players"_n.value:      export_rows(players_table(get_self(), page.scope.value), cursor, limit, page); break;
+         case "supports"_n.value:     export_rows(supports_table(get_self(), page.scope.value), cursor, limit, page); break;
+         case "forge"_n.value:        export_rows(forge_table(get_self(), page.scope.value), cursor, limit, page); break;
+         case "chests"_n.value:       export_rows(chests_table(get_self(), page.scope.value), cursor, limit, page); break;
+         case "missions"_n.value:     export_rows(missions_table(get_self(), page.scope.value), cursor, limit, page); break;
+         case "attackshards"_n.value: export_rows(attack_shards_table(get_self(), page.scope.value), cursor, limit, page); break;
+         case "playermiss"_n.value:   export_rows(player_missions_table(get_self(), page.scope.value), cursor, limit, page); break;
+         case "members"_n.value:      export_rows(member_table(get_self(), page.scope.value), cursor, limit, page); break;
+         case "purges"_n.value:       export_rows(purges_table(get_self(), page.scope.value), cursor, limit, page); break;
+         default: check(false, "Unknown table");
+      }
+      return page;
+   }
+
 
 
 
 [[eosio::on_notify("alien.worlds::transfer")]]
 
-void on_transfer(name from, name to, asset quantity, std::string memo) {
-   check(false, "ici");
+void on_transfer(name from, name to, asset quantity, const std::string& memo) {
    // Ensure the transfer is to this contract and not from this contract, and the memo is not to be ignored.
    if (to != get_self() || from == get_self() || memo == "ignore_memo") return;
    
    // Check if the currency is TLM and proceed only if it is.
    if (quantity.symbol == symbol("TLM", 4)) {
       if (quantity.amount == 10000 * 10000) { // Assuming TLM has 4 decimal places
-         addtoforge(from); 
+         action_context ctx(get_self());
+         addtoforge(ctx, from);
          return;
       } else if (quantity.amount == 90 * 10000) { // Assuming TLM has 4 decimal places
-         check(false, "here");
          addmember(from);
          return;
       }
@@ -626,8 +814,8 @@ void on_transfer(name from, name to, asset quantity, std::string memo) {
       // Extract land_id from the memo for chest updates.
       auto separator_pos = memo.find(":");
       if (separator_pos != std::string::npos) { // Correct memo format check
-         // Convert the substring after the separator to uint64_t for land_id
-         uint64_t land_id = std::stoull(memo.substr(separator_pos + 1));
+         // Convert the digits after the separator to uint64_t for land_id
+         uint64_t land_id = parse_land_id(memo, separator_pos + 1);
          
          // Proceed if land_id is greater than 0
          if (land_id > 0){
@@ -646,15 +834,14 @@ void on_transfer(name from, name to, asset quantity, std::string memo) {
 
 
     private:
- void upsupport(name entity) {
-    // Accès aux tables
-    players_table _players(get_self(), get_self().value);
-    owners_table _owners(get_self(), get_self().value);
-    supports_table _supports(get_self(), get_self().value);
-    forge_table _forge(get_self(), get_self().value);
+ void upsupport(action_context& ctx, name entity) {
+    // Accès aux tables partagées de l'action
+    auto& _players = ctx.players;
+    auto& _owners = ctx.owners;
+    auto& _supports = ctx.supports;
 
     name owner_key = entity; // Par défaut, considérez l'entité comme le propriétaire
-    bool is_owner_in_forge = _forge.find(entity.value) != _forge.end();
+    bool is_owner_in_forge = ctx.in_forge(entity);
     uint64_t number_of_lands = 1;
 
     // Initialiser les scores pour le recalcul
@@ -686,7 +873,7 @@ void on_transfer(name from, name to, asset quantity, std::string memo) {
     // Inclure les scores du propriétaire s'il est dans la forge
     auto owner_itr = _owners.find(owner_key.value);
     if (owner_itr != _owners.end()) {
-        is_owner_in_forge = _forge.find(owner_key.value) != _forge.end(); // Vérifiez à nouveau pour le propriétaire
+        is_owner_in_forge = ctx.in_forge(owner_key); // Vérifiez à nouveau pour le propriétaire
         total_defense_score += is_owner_in_forge ? owner_itr->totalDefenseArm : owner_itr->totalDefense;
         total_attack_score += is_owner_in_forge ? owner_itr->totalAttackArm : owner_itr->totalAttack;
         total_move_cost += owner_itr->totalMoveCost; // Le coût de déplacement n'est pas divisé par le nombre de terrains
@@ -699,7 +886,7 @@ void on_transfer(name from, name to, asset quantity, std::string memo) {
         for (const auto& supporter : support_itr->supporters) {
             auto player_supporter_itr = _players.find(supporter.value);
             if (player_supporter_itr != _players.end()) {
-                bool is_player_in_forge = _forge.find(supporter.value) != _forge.end();
+                bool is_player_in_forge = ctx.in_forge(supporter);
                 total_defense_score += (is_player_in_forge ? player_supporter_itr->totalDefenseArm : player_supporter_itr->totalDefense) / number_of_lands;
                 total_attack_score += (is_player_in_forge ? player_supporter_itr->totalAttackArm : player_supporter_itr->totalAttack) / number_of_lands;
                 total_move_cost += player_supporter_itr->totalMoveCost / number_of_lands; // Diviser le coût de déplacement peut ne pas être logique; ajustez si nécessaire
@@ -713,7 +900,7 @@ void on_transfer(name from, name to, asset quantity, std::string memo) {
             s.totalMoveCost = total_move_cost;
         });
     } else {
-        eosio::print("Aucune ligne de support trouvée pour ce propriétaire.");
+        DEBUG_PRINT("Aucune ligne de support trouvée pour ce propriétaire.");
     }
 }
 
@@ -749,6 +936,24 @@ void on_transfer(name from, name to, asset quantity, std::string memo) {
    }
 
 
+    // Parse the decimal land_id of a memo in place, without copying the memo.
+    // Like std::stoull, leading whitespace and a '+' sign are accepted.
+    uint64_t parse_land_id(const std::string& memo, size_t pos) {
+        while (pos < memo.size() && (memo[pos] == ' ' || (memo[pos] >= '\t' && memo[pos] <= '\r'))) ++pos;
+        if (pos < memo.size() && memo[pos] == '+') ++pos;
+
+        check(pos < memo.size() && memo[pos] >= '0' && memo[pos] <= '9', "Invalid land_id in memo");
+
+        uint64_t land_id = 0;
+        for (; pos < memo.size() && memo[pos] >= '0' && memo[pos] <= '9'; ++pos) {
+            uint64_t digit = memo[pos] - '0';
+            check(land_id <= (UINT64_MAX - digit) / 10, "Invalid land_id in memo");
+            land_id = land_id * 10 + digit;
+        }
+        return land_id;
+    }
+
+
     // Private function to update chest level
      void update_chest_level(uint64_t land_id, std::optional<uint64_t> new_level) {
         chests_table chests(get_self(), get_self().value);
@@ -773,16 +978,260 @@ void on_transfer(name from, name to, asset quantity, std::string memo) {
       });
    }
 
-   void addtoforge(name player) {
-      forge_table forge(get_self(), get_self().value);
-      auto itr = forge.find(player.value);
-      check(itr == forge.end(), "Player already in forge");
+   // Ajoute à la page au plus limit lignes à partir de la clé primaire cursor
+   template<typename Table>
+   static void export_rows(const Table& table, uint64_t cursor, uint32_t limit, export_page& page) {
+      auto itr = table.lower_bound(cursor);
+      for (; itr != table.end() && page.row_count < limit; ++itr) {
+         auto packed_row = pack(*itr);
+         page.rows.insert(page.rows.end(), packed_row.begin(), packed_row.end());
+         ++page.row_count;
+      }
+
+      page.more = itr != table.end();
+      page.next_cursor = page.more ? itr->primary_key() : 0;
+   }
+
+   // Fraction de points d'attaque d'un joueur. Seuls les bits de poids fort d'un name
+   // court sont non nuls : ils sont redescendus par le finaliseur de MurmurHash3.
+   static uint64_t attack_shard_of(name player) {
+      uint64_t h = player.value;
+      h ^= h >> 33;
+      h *= 0xFF51AFD7ED558CCDULL;
+      h ^= h >> 33;
+      h *= 0xC4CEB9FE1A85EC53ULL;
+      h ^= h >> 33;
+      return h % ATTACK_SHARDS;
+   }
+
+   // Reporte les fractions et les points utiles de l'attaque dans la mission, puis répartit
+   // le reste à atteindre, relu dans la mission (donc après un éventuel durcissement), en
+   // quotas entre les fractions. Sans reste, la mission est complétée ; si un quota ne peut
+   // pas absorber une attaque de cette taille, les fractions sont simplement supprimées.
+   // has_shards est faux quand la mission n'a pas de fractions, pour ne pas les parcourir.
+   // Renvoie les points d'attaque utiles.
+   uint64_t rebalance_attack_shards(missions_table& missions, missions_table::const_iterator mission_itr, attack_shards_table& shards,
+                                    bool has_shards, uint64_t attack_points) {
+      uint64_t total_attack_points = mission_itr->total_attack_points;
+      if (has_shards) {
+         for (const auto& shard : shards) {
+            total_attack_points += shard.attack_points;
+         }
+      }
+
+      uint64_t target = mission_itr->target_attack_points;
+      uint64_t remaining = target > total_attack_points ? target - total_attack_points : 0;
+      uint64_t useful_attack_points = std::min(attack_points, remaining);
+      remaining -= useful_attack_points;
+
+      missions.modify(mission_itr, get_self(), [&](auto& mod_mission) {
+         mod_mission.total_attack_points = total_attack_points + useful_attack_points;
+         if (remaining == 0) {
+               mod_mission.is_completed = true;
+         }
+      });
+
+      if (remaining == 0 || remaining / ATTACK_SHARDS <= attack_points) {
+         if (has_shards) {
+            for (auto itr = shards.begin(); itr != shards.end(); ) {
+               itr = shards.erase(itr);
+            }
+         }
+         return useful_attack_points;
+      }
+
+      for (uint64_t shard_id = 0; shard_id < ATTACK_SHARDS; ++shard_id) {
+         uint64_t quota = remaining / ATTACK_SHARDS + (shard_id < remaining % ATTACK_SHARDS ? 1 : 0);
+         auto itr = shards.find(shard_id);
+         if (itr == shards.end()) {
+            shards.emplace(get_self(), [&](auto& new_shard) {
+               new_shard.shard = shard_id;
+               new_shard.attack_points = 0;
+               new_shard.quota = quota;
+            });
+         } else {
+            shards.modify(itr, get_self(), [&](auto& mod_shard) {
+               mod_shard.attack_points = 0;
+               mod_shard.quota = quota;
+            });
+         }
+      }
+      return useful_attack_points;
+   }
+
+   // Retire un terrain ; un owner sans terrain est supprimé et son nettoyage planifié
+   void remove_land(action_context& ctx, name owner, uint64_t land_id) {
+      auto& owners = ctx.owners;
+      auto it = owners.find(owner.value);
+      check(it != owners.end(), "Owner not found");
+
+      auto land_itr = std::find(it->land_ids.begin(), it->land_ids.end(), land_id);
+      check(land_itr != it->land_ids.end(), "Land not found for this owner");
+
+      // Le coffre du terrain ne désigne plus l'owner : un coffre vide est supprimé,
+      // un coffre qui contient encore du TLM est conservé sans propriétaire
+      chests_table chests(get_self(), get_self().value);
+      auto chest_itr = chests.find(land_id);
+      if (chest_itr != chests.end() && chest_itr->owner == owner) {
+         if (chest_itr->TLM == 0) {
+            chests.erase(chest_itr);
+         } else {
+            chests.modify(chest_itr, get_self(), [&](auto& chest) {
+               chest.owner = name();
+            });
+         }
+      }
+
+      // Si le propriétaire n'a plus de terrain, le supprimer de la table
+      if (it->land_ids.size() == 1) {
+         owners.erase(it);
+         queue_purge(owner, PURGE_OWNER);
+         return;
+      }
 
-      forge.emplace(get_self(), [&](auto& row) {
-         row.player_address = player;
+      owners.modify(it, get_self(), [&](auto& row) {
+         row.land_ids.erase(std::find(row.land_ids.begin(), row.land_ids.end(), land_id));
+         if (row.numberofland > 0) row.numberofland--; // Décrémenter comme addowners incrémente
       });
+      upsupport(ctx, owner); // Les scores des supporters sont divisés par le nombre de terrains
+   }
+
+   // Ajoute un compte à la file de nettoyage avec le rôle qui lui est retiré
+   // (ou repart de zéro s'il y est déjà)
+   void queue_purge(name account, uint8_t role) {
+      purges_table purges(get_self(), get_self().value);
+      auto itr = purges.find(account.value);
+      if (itr == purges.end()) {
+         purges.emplace(get_self(), [&](auto& row) {
+            row.account = account;
+            row.roles = role;
+            row.stage = PURGE_SUPPORTS;
+            row.cursor = 0;
+         });
+      } else {
+         purges.modify(itr, get_self(), [&](auto& row) {
+            row.roles |= role;
+            row.stage = PURGE_SUPPORTS;
+            row.cursor = 0;
+         });
+      }
+   }
+
+   // Traite la file de nettoyage dans l'ordre en parcourant au plus budget lignes
+   void run_purges(action_context& ctx, uint32_t budget) {
+      purges_table purges(get_self(), get_self().value);
+      auto itr = purges.begin();
+      while (itr != purges.end() && budget > 0) {
+         if (!purge_account(ctx, purges, *itr, budget)) {
+            return; // Budget épuisé, la progression est enregistrée dans la ligne
+         }
+         itr = purges.erase(itr);
+      }
+   }
+
+   // Supprime les lignes qui référencent encore un compte supprimé (les coffres sont traités
+   // terrain par terrain dans remove_land). Un compte qui est de nouveau owner ou player
+   // conserve les lignes correspondantes.
+   // Renvoie false si le budget est épuisé avant la fin ; l'étape et le curseur sont alors sauvegardés.
+   bool purge_account(action_context& ctx, purges_table& purges, const purge_struct& entry, uint32_t& budget) {
+      name account = entry.account;
+      uint8_t stage = entry.stage;
+      uint64_t cursor = entry.cursor;
+
+      bool is_owner = ctx.owners.find(account.value) != ctx.owners.end();
+      bool is_player = ctx.players.find(account.value) != ctx.players.end();
+
+      auto suspend = [&](uint8_t at_stage, uint64_t at_cursor) {
+         purges.modify(entry, get_self(), [&](auto& row) {
+            row.stage = at_stage;
+            row.cursor = at_cursor;
+         });
+         return false;
+      };
+
+      if (stage == PURGE_SUPPORTS) {
+         auto& supports = ctx.supports;
+
+         // La ligne de soutien de l'owner supprimé
+         if ((entry.roles & PURGE_OWNER) && !is_owner) {
+            auto own_itr = supports.find(account.value);
+            if (own_itr != supports.end()) {
+               supports.erase(own_itr);
+            }
+         }
+
+         // L'appartenance du joueur supprimé aux soutiens des autres owners ; addsupport
+         // n'accepte que des players, un owner qui n'a jamais été player n'en a aucune
+         if ((entry.roles & PURGE_PLAYER) && !is_player) {
+            for (auto itr = supports.lower_bound(cursor); itr != supports.end(); ) {
+               if (budget == 0) return suspend(PURGE_SUPPORTS, itr->owner_address.value);
+               --budget;
+
+               auto member_itr = std::find(itr->supporters.begin(), itr->supporters.end(), account);
+               if (member_itr == itr->supporters.end()) {
+                  ++itr;
+                  continue;
+               }
+
+               name supported_owner = itr->owner_address;
+               supports.modify(itr, get_self(), [&](auto& s) {
+                  s.supporters.erase(std::find(s.supporters.begin(), s.supporters.end(), account));
+               });
+               ++itr;
+               upsupport(ctx, supported_owner); // Recalculer les scores sans le joueur supprimé
+            }
+         }
+         stage = PURGE_PARTICIPATION;
+         cursor = 0;
+      }
+
+      if (stage == PURGE_PARTICIPATION) {
+         // Les participations du compte, sauf celles des missions dont les récompenses restent à distribuer :
+         // elles sont notées dans la scope de la mission pour que distributere les supprime après le paiement
+         if (!is_owner && !is_player) {
+            missions_table missions(get_self(), get_self().value);
+            player_missions_table player_missions(get_self(), get_self().value);
+            auto player_index = player_missions.get_index<"byplayer"_n>();
+
+            auto itr = player_index.lower_bound(account.value);
+            auto resume_itr = player_missions.find(cursor);
+            if (cursor != 0 && resume_itr != player_missions.end() && resume_itr->player == account) {
+               itr = player_index.iterator_to(*resume_itr);
+            }
+
+            while (itr != player_index.end() && itr->player == account) {
+               if (budget == 0) return suspend(PURGE_PARTICIPATION, itr->id);
+               --budget;
+
+               auto mission_itr = missions.find(itr->mission_name.value);
+               if (mission_itr == missions.end() || mission_itr->is_distributed) {
+                  itr = player_index.erase(itr);
+                  continue;
+               }
+
+               purges_table pending(get_self(), itr->mission_name.value);
+               if (pending.find(account.value) == pending.end()) {
+                  pending.emplace(get_self(), [&](auto& row) {
+                     row.account = account;
+                     row.roles = entry.roles;
+                     row.stage = PURGE_PARTICIPATION;
+                     row.cursor = itr->id;
+                  });
+               }
+               ++itr;
+            }
+         }
+      }
+
+      return true;
+   }
+
+   void addtoforge(action_context& ctx, name player) {
+      check(!ctx.in_forge(player), "Player already in forge");
+
+      ctx.add_to_forge(get_self(), player);
 
-      upsupport(player); // Pas besoin de spécifier le type ici
+      upsupport(ctx, player); // Pas besoin de spécifier le type ici
    }
 
 
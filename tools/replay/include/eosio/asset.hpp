@@ -0,0 +1,4 @@
+// Doublure native : symbol et asset sont définis dans eosio.hpp.
+#pragma once
+
+#include <eosio/eosio.hpp>
@@ -0,0 +1,914 @@
+// Doublure native (en mémoire) du sous-ensemble de eosio.cdt utilisé par
+// smart_contract.cpp. Elle permet de compiler le contrat avec un compilateur
+// C++17 classique et de le piloter depuis l'outil de rejeu (tools/replay).
+//
+// Le comportement suit celui de la chaîne là où il est observable par le
+// contrat : lignes stockées sous forme sérialisée, cache d'objets propre à
+// chaque instance de multi_index, échec d'une action = annulation de toutes
+// ses écritures. Chaque appel qui correspondrait à un intrinsèque de base de
+// données est compté dans native::state().db_ops.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#define CONTRACT class [[eosio::contract]]
+#define ACTION [[eosio::action]] void
+#define TABLE struct [[eosio::table]]
+
+namespace eosio {
+
+   // ---------------------------------------------------------------------
+   // Assertions
+   // ---------------------------------------------------------------------
+
+   struct eosio_assert_exception : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   inline void check(bool pred, const char* msg) {
+      if (!pred) throw eosio_assert_exception(msg);
+   }
+
+   inline void check(bool pred, const std::string& msg) {
+      if (!pred) throw eosio_assert_exception(msg);
+   }
+
+   // ---------------------------------------------------------------------
+   // name
+   // ---------------------------------------------------------------------
+
+   struct name {
+      enum class raw : uint64_t {};
+
+      uint64_t value = 0;
+
+      constexpr name() = default;
+      constexpr explicit name(uint64_t v) : value(v) {}
+      constexpr name(raw r) : value(static_cast<uint64_t>(r)) {}
+
+      constexpr explicit name(std::string_view str) {
+         if (str.size() > 13) throw eosio_assert_exception("string is too long to be a valid name");
+         const auto n = std::min<std::size_t>(str.size(), 12);
+         for (std::size_t i = 0; i < n; ++i) {
+            value <<= 5;
+            value |= char_to_value(str[i]);
+         }
+         value <<= (4 + 5 * (12 - n));
+         if (str.size() == 13) {
+            const uint64_t v = char_to_value(str[12]);
+            if (v > 0x0F) throw eosio_assert_exception("thirteenth character in name cannot be a letter that comes after j");
+            value |= v;
+         }
+      }
+
+      static constexpr uint8_t char_to_value(char c) {
+         if (c == '.') return 0;
+         if (c >= '1' && c <= '5') return (c - '1') + 1;
+         if (c >= 'a' && c <= 'z') return (c - 'a') + 6;
+         throw eosio_assert_exception("character is not in allowed character set for names");
+      }
+
+      constexpr operator raw() const { return raw(value); }
+      constexpr explicit operator bool() const { return value != 0; }
+
+      std::string to_string() const {
+         static const char* charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+         std::string str(13, '.');
+         uint64_t tmp = value;
+         for (uint32_t i = 0; i <= 12; ++i) {
+            const char c = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
+            str[12 - i] = c;
+            tmp >>= (i == 0 ? 4 : 5);
+         }
+         const auto last = str.find_last_not_of('.');
+         str.erase(last == std::string::npos ? 0 : last + 1);
+         return str;
+      }
+
+      friend constexpr bool operator==(const name& a, const name& b) { return a.value == b.value; }
+      friend constexpr bool operator!=(const name& a, const name& b) { return a.value != b.value; }
+      friend constexpr bool operator<(const name& a, const name& b) { return a.value < b.value; }
+   };
+
+   inline std::ostream& operator<<(std::ostream& os, const name& n) { return os << n.to_string(); }
+
+   inline namespace literals {
+      constexpr name operator""_n(const char* s, std::size_t n) { return name(std::string_view(s, n)); }
+   }
+
+   // ---------------------------------------------------------------------
+   // symbol / asset (déclarés ici pour que la sérialisation les connaisse)
+   // ---------------------------------------------------------------------
+
+   class symbol_code {
+   public:
+      constexpr symbol_code() = default;
+      constexpr explicit symbol_code(uint64_t raw) : _value(raw) {}
+      constexpr explicit symbol_code(std::string_view str) {
+         if (str.size() > 7) throw eosio_assert_exception("string is too long to be a valid symbol_code");
+         for (auto itr = str.rbegin(); itr != str.rend(); ++itr) {
+            if (*itr < 'A' || *itr > 'Z') throw eosio_assert_exception("only uppercase letters allowed in symbol_code string");
+            _value <<= 8;
+            _value |= *itr;
+         }
+      }
+
+      constexpr uint64_t raw() const { return _value; }
+
+      std::string to_string() const {
+         std::string s;
+         for (uint64_t v = _value; v > 0; v >>= 8) s.push_back(char(v & 0xFF));
+         return s;
+      }
+
+      friend constexpr bool operator==(const symbol_code& a, const symbol_code& b) { return a._value == b._value; }
+      friend constexpr bool operator!=(const symbol_code& a, const symbol_code& b) { return a._value != b._value; }
+
+   private:
+      uint64_t _value = 0;
+   };
+
+   class symbol {
+   public:
+      constexpr symbol() = default;
+      constexpr explicit symbol(uint64_t raw) : _value(raw) {}
+      constexpr symbol(symbol_code sc, uint8_t precision) : _value((sc.raw() << 8) | precision) {}
+      constexpr symbol(std::string_view code, uint8_t precision) : symbol(symbol_code(code), precision) {}
+
+      constexpr uint64_t raw() const { return _value; }
+      constexpr uint8_t precision() const { return uint8_t(_value & 0xFF); }
+      constexpr symbol_code code() const { return symbol_code(_value >> 8); }
+
+      friend constexpr bool operator==(const symbol& a, const symbol& b) { return a._value == b._value; }
+      friend constexpr bool operator!=(const symbol& a, const symbol& b) { return a._value != b._value; }
+
+   private:
+      uint64_t _value = 0;
+   };
+
+   struct asset {
+      int64_t amount = 0;
+      eosio::symbol symbol;
+
+      asset() = default;
+      asset(int64_t a, eosio::symbol s) : amount(a), symbol(s) {}
+
+      std::string to_string() const {
+         const uint8_t p = symbol.precision();
+         const bool negative = amount < 0;
+         uint64_t abs = negative ? uint64_t(-amount) : uint64_t(amount);
+         std::string digits = std::to_string(abs);
+         if (p > 0) {
+            if (digits.size() <= p) digits.insert(0, p - digits.size() + 1, '0');
+            digits.insert(digits.size() - p, 1, '.');
+         }
+         return (negative ? "-" : "") + digits + " " + symbol.code().to_string();
+      }
+
+      friend bool operator==(const asset& a, const asset& b) { return a.amount == b.amount && a.symbol == b.symbol; }
+      friend bool operator!=(const asset& a, const asset& b) { return !(a == b); }
+   };
+
+   inline std::ostream& operator<<(std::ostream& os, const asset& a) { return os << a.to_string(); }
+
+   // ---------------------------------------------------------------------
+   // Temps
+   // ---------------------------------------------------------------------
+
+   class microseconds {
+   public:
+      constexpr explicit microseconds(int64_t c = 0) : _count(c) {}
+      constexpr int64_t count() const { return _count; }
+      int64_t _count;
+   };
+
+   class time_point {
+   public:
+      constexpr explicit time_point(microseconds e = microseconds()) : elapsed(e) {}
+      constexpr const microseconds& time_since_epoch() const { return elapsed; }
+      constexpr uint32_t sec_since_epoch() const { return uint32_t(elapsed.count() / 1000000); }
+      microseconds elapsed;
+   };
+
+   class time_point_sec {
+   public:
+      constexpr time_point_sec() = default;
+      constexpr explicit time_point_sec(uint32_t seconds) : utc_seconds(seconds) {}
+      constexpr time_point_sec(const time_point& t) : utc_seconds(t.sec_since_epoch()) {}
+      constexpr uint32_t sec_since_epoch() const { return utc_seconds; }
+      uint32_t utc_seconds = 0;
+   };
+
+   // ---------------------------------------------------------------------
+   // Sérialisation (format binaire de la chaîne)
+   // ---------------------------------------------------------------------
+
+   template<typename T>
+   class datastream {
+   public:
+      datastream(T start, std::size_t s) : _start(start), _pos(start), _end(start + s) {}
+      T pos() const { return _pos; }
+      std::size_t remaining() const { return std::size_t(_end - _pos); }
+   private:
+      T _start;
+      T _pos;
+      T _end;
+   };
+
+   namespace reflect {
+      struct any_field {
+         template<typename U> operator U() const;
+      };
+
+      template<typename T, typename... A>
+      constexpr auto brace_constructible(int) -> decltype(T{std::declval<A>()...}, true) { return true; }
+      template<typename T, typename... A>
+      constexpr bool brace_constructible(...) { return false; }
+
+      template<typename T, std::size_t... I>
+      constexpr bool constructible_with(std::index_sequence<I...>) {
+         return brace_constructible<T, decltype((void)I, any_field{})...>(0);
+      }
+
+      template<typename T, std::size_t N = 12>
+      constexpr std::size_t field_count() {
+         if constexpr (N == 0) return 0;
+         else if constexpr (constructible_with<T>(std::make_index_sequence<N>{})) return N;
+         else return field_count<T, N - 1>();
+      }
+
+      // Applique f à chaque champ d'un agrégat, dans l'ordre de déclaration.
+      template<typename T, typename F>
+      void for_each_field(T& t, F&& f) {
+         constexpr auto n = field_count<std::remove_const_t<T>>();
+         static_assert(n > 0, "type not serializable");
+         if constexpr (n == 1) { auto& [a] = t; f(a); }
+         else if constexpr (n == 2) { auto& [a, b] = t; f(a); f(b); }
+         else if constexpr (n == 3) { auto& [a, b, c] = t; f(a); f(b); f(c); }
+         else if constexpr (n == 4) { auto& [a, b, c, d] = t; f(a); f(b); f(c); f(d); }
+         else if constexpr (n == 5) { auto& [a, b, c, d, e] = t; f(a); f(b); f(c); f(d); f(e); }
+         else if constexpr (n == 6) { auto& [a, b, c, d, e, g] = t; f(a); f(b); f(c); f(d); f(e); f(g); }
+         else if constexpr (n == 7) { auto& [a, b, c, d, e, g, h] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); }
+         else if constexpr (n == 8) { auto& [a, b, c, d, e, g, h, i] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); }
+         else if constexpr (n == 9) { auto& [a, b, c, d, e, g, h, i, j] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); }
+         else if constexpr (n == 10) { auto& [a, b, c, d, e, g, h, i, j, k] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); }
+         else if constexpr (n == 11) { auto& [a, b, c, d, e, g, h, i, j, k, l] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); f(l); }
+         else { auto& [a, b, c, d, e, g, h, i, j, k, l, m] = t; f(a); f(b); f(c); f(d); f(e); f(g); f(h); f(i); f(j); f(k); f(l); f(m); }
+      }
+
+      template<typename T> struct is_vector : std::false_type {};
+      template<typename T, typename A> struct is_vector<std::vector<T, A>> : std::true_type {};
+      template<typename T> struct is_optional : std::false_type {};
+      template<typename T> struct is_optional<std::optional<T>> : std::true_type {};
+      template<typename T> struct is_tuple : std::false_type {};
+      template<typename... T> struct is_tuple<std::tuple<T...>> : std::true_type {};
+      template<typename A, typename B> struct is_tuple<std::pair<A, B>> : std::true_type {};
+   }
+
+   namespace serial {
+      inline void write_varuint32(std::vector<char>& out, uint32_t v) {
+         do {
+            uint8_t b = uint8_t(v & 0x7F);
+            v >>= 7;
+            b |= uint8_t((v > 0) << 7);
+            out.push_back(char(b));
+         } while (v);
+      }
+
+      struct reader {
+         const char* pos;
+         const char* end;
+
+         void take(void* dst, std::size_t n) {
+            check(std::size_t(end - pos) >= n, "datastream attempted to read past the end");
+            std::memcpy(dst, pos, n);
+            pos += n;
+         }
+
+         uint32_t varuint32() {
+            uint32_t v = 0;
+            uint8_t b = 0;
+            uint8_t by = 0;
+            do {
+               take(&b, 1);
+               v |= uint32_t(b & 0x7F) << by;
+               by += 7;
+            } while ((b & 0x80) && by < 32);
+            return v;
+         }
+      };
+
+      template<typename T>
+      void write(std::vector<char>& out, const T& v) {
+         if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>) {
+            const char* p = reinterpret_cast<const char*>(&v);
+            out.insert(out.end(), p, p + sizeof(T));
+         } else if constexpr (std::is_same_v<T, name>) {
+            write(out, v.value);
+         } else if constexpr (std::is_same_v<T, symbol> || std::is_same_v<T, symbol_code>) {
+            write(out, v.raw());
+         } else if constexpr (std::is_same_v<T, asset>) {
+            write(out, v.amount);
+            write(out, v.symbol);
+         } else if constexpr (std::is_same_v<T, time_point_sec>) {
+            write(out, v.utc_seconds);
+         } else if constexpr (std::is_same_v<T, time_point>) {
+            write(out, v.elapsed.count());
+         } else if constexpr (std::is_same_v<T, std::string>) {
+            write_varuint32(out, uint32_t(v.size()));
+            out.insert(out.end(), v.begin(), v.end());
+         } else if constexpr (reflect::is_vector<T>::value) {
+            write_varuint32(out, uint32_t(v.size()));
+            for (const auto& e : v) write(out, e);
+         } else if constexpr (reflect::is_optional<T>::value) {
+            write(out, bool(v.has_value()));
+            if (v) write(out, *v);
+         } else if constexpr (reflect::is_tuple<T>::value) {
+            std::apply([&](const auto&... e) { (write(out, e), ...); }, v);
+         } else {
+            reflect::for_each_field(v, [&](const auto& f) { write(out, f); });
+         }
+      }
+
+      template<typename T>
+      void read(reader& in, T& v) {
+         if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>) {
+            in.take(&v, sizeof(T));
+         } else if constexpr (std::is_same_v<T, name>) {
+            read(in, v.value);
+         } else if constexpr (std::is_same_v<T, symbol> || std::is_same_v<T, symbol_code>) {
+            uint64_t raw = 0;
+            read(in, raw);
+            v = T(raw);
+         } else if constexpr (std::is_same_v<T, asset>) {
+            read(in, v.amount);
+            read(in, v.symbol);
+         } else if constexpr (std::is_same_v<T, time_point_sec>) {
+            read(in, v.utc_seconds);
+         } else if constexpr (std::is_same_v<T, time_point>) {
+            int64_t c = 0;
+            read(in, c);
+            v = time_point(microseconds(c));
+         } else if constexpr (std::is_same_v<T, std::string>) {
+            const uint32_t n = in.varuint32();
+            v.resize(n);
+            if (n) in.take(v.data(), n);
+         } else if constexpr (reflect::is_vector<T>::value) {
+            const uint32_t n = in.varuint32();
+            v.clear();
+            v.resize(n);
+            for (auto& e : v) read(in, e);
+         } else if constexpr (reflect::is_optional<T>::value) {
+            bool has = false;
+            read(in, has);
+            v.reset();
+            if (has) {
+               typename T::value_type e{};
+               read(in, e);
+               v = std::move(e);
+            }
+         } else if constexpr (reflect::is_tuple<T>::value) {
+            std::apply([&](auto&... e) { (read(in, e), ...); }, v);
+         } else {
+            reflect::for_each_field(v, [&](auto& f) { read(in, f); });
+         }
+      }
+   }
+
+   template<typename T>
+   std::vector<char> pack(const T& v) {
+      std::vector<char> out;
+      serial::write(out, v);
+      return out;
+   }
+
+   template<typename T>
+   std::size_t pack_size(const T& v) {
+      return pack(v).size();
+   }
+
+   template<typename T>
+   T unpack(const char* buffer, std::size_t len) {
+      T v{};
+      serial::reader in{buffer, buffer + len};
+      serial::read(in, v);
+      return v;
+   }
+
+   template<typename T>
+   T unpack(const std::vector<char>& bytes) {
+      return unpack<T>(bytes.data(), bytes.size());
+   }
+
+   // ---------------------------------------------------------------------
+   // État de la chaîne simulée
+   // ---------------------------------------------------------------------
+
+   struct permission_level {
+      name actor;
+      name permission;
+   };
+
+   struct action;
+
+   namespace native {
+      struct row {
+         std::vector<char> data;
+         std::vector<uint64_t> secondary; // une clé par index secondaire
+         uint64_t payer = 0;
+      };
+
+      struct table_data {
+         std::map<uint64_t, row> rows;
+         std::vector<std::set<std::pair<uint64_t, uint64_t>>> secondary; // (clé secondaire, clé primaire)
+      };
+
+      struct table_id {
+         uint64_t code;
+         uint64_t scope;
+         uint64_t table;
+         bool operator<(const table_id& o) const {
+            return std::tie(code, scope, table) < std::tie(o.code, o.scope, o.table);
+         }
+      };
+
+      struct inline_action {
+         name account;
+         name action_name;
+         std::vector<permission_level> authorization;
+         std::vector<char> data;
+      };
+
+      struct undo_entry {
+         table_data* table;
+         uint64_t primary;
+         std::optional<row> previous;
+      };
+
+      struct chain_state {
+         std::map<table_id, table_data> tables;
+         std::set<uint64_t> auths;
+         int64_t now_us = 0;
+         std::vector<inline_action> inline_actions;
+         std::map<std::string, uint64_t> db_ops;
+         std::vector<undo_entry> undo;
+         std::vector<char> return_value;
+         std::ostream* console = nullptr;
+
+         table_data& table(uint64_t code, uint64_t scope, uint64_t tbl) {
+            return tables[table_id{code, scope, tbl}];
+         }
+
+         void count(const char* op) { ++db_ops[op]; }
+
+         // Écrit (ou supprime si r est vide) une ligne en journalisant l'état précédent.
+         void write(table_data& t, uint64_t primary, std::optional<row> r) {
+            auto it = t.rows.find(primary);
+            std::optional<row> previous;
+            if (it != t.rows.end()) previous = it->second;
+            undo.push_back(undo_entry{&t, primary, previous});
+            apply(t, primary, std::move(r));
+         }
+
+         static void apply(table_data& t, uint64_t primary, std::optional<row> r) {
+            auto it = t.rows.find(primary);
+            if (it != t.rows.end()) {
+               for (std::size_t i = 0; i < it->second.secondary.size(); ++i)
+                  t.secondary[i].erase({it->second.secondary[i], primary});
+               t.rows.erase(it);
+            }
+            if (r) {
+               if (t.secondary.size() < r->secondary.size()) t.secondary.resize(r->secondary.size());
+               for (std::size_t i = 0; i < r->secondary.size(); ++i)
+                  t.secondary[i].insert({r->secondary[i], primary});
+               t.rows.emplace(primary, std::move(*r));
+            }
+         }
+
+         // Début d'une action : efface le journal et les effets de l'action précédente.
+         void begin_action(std::set<uint64_t> authorizers) {
+            auths = std::move(authorizers);
+            undo.clear();
+            inline_actions.clear();
+            return_value.clear();
+         }
+
+         // Échec d'une action : annule toutes ses écritures.
+         void rollback() {
+            for (auto it = undo.rbegin(); it != undo.rend(); ++it)
+               apply(*it->table, it->primary, it->previous);
+            undo.clear();
+            inline_actions.clear();
+            return_value.clear();
+         }
+      };
+
+      inline chain_state& state() {
+         static chain_state s;
+         return s;
+      }
+   }
+
+   // ---------------------------------------------------------------------
+   // Autorisations, console, actions
+   // ---------------------------------------------------------------------
+
+   inline bool has_auth(name n) { return native::state().auths.count(n.value) > 0; }
+
+   inline void require_auth(name n) {
+      check(has_auth(n), "missing authority of " + n.to_string());
+   }
+
+   inline void require_auth(const permission_level& level) { require_auth(level.actor); }
+
+   template<typename... Args>
+   void print(Args&&... args) {
+      if (auto* out = native::state().console) ((*out << args), ...);
+   }
+
+   struct action {
+      std::vector<permission_level> authorization;
+      name account;
+      name action_name;
+      std::vector<char> data;
+
+      template<typename T>
+      action(const permission_level& auth, name a, name n, T&& value)
+         : authorization{auth}, account(a), action_name(n), data(pack(value)) {}
+
+      void send() const {
+         native::state().count("send_inline");
+         native::state().inline_actions.push_back(native::inline_action{account, action_name, authorization, data});
+      }
+   };
+
+   template<typename T>
+   void set_action_return_value(const T& value) {
+      native::state().return_value = pack(value);
+   }
+
+   // ---------------------------------------------------------------------
+   // contract
+   // ---------------------------------------------------------------------
+
+   class contract {
+   public:
+      contract(name self, name first_receiver, datastream<const char*> ds)
+         : _self(self), _first_receiver(first_receiver), _ds(ds) {}
+
+      name get_self() const { return _self; }
+      name get_code() const { return _self; }
+      name get_first_receiver() const { return _first_receiver; }
+      datastream<const char*>& get_datastream() { return _ds; }
+
+   protected:
+      name _self;
+      name _first_receiver;
+      datastream<const char*> _ds;
+   };
+
+   // ---------------------------------------------------------------------
+   // multi_index
+   // ---------------------------------------------------------------------
+
+   template<class Class, typename Type, Type (Class::*PtrToMemberFunction)() const>
+   struct const_mem_fun {
+      using result_type = Type;
+      Type operator()(const Class& c) const { return (c.*PtrToMemberFunction)(); }
+   };
+
+   template<name::raw IndexName, typename Extractor>
+   struct indexed_by {
+      static constexpr name::raw index_name = IndexName;
+      using secondary_extractor_type = Extractor;
+   };
+
+   template<name::raw TableName, typename T, typename... Indices>
+   class multi_index {
+      static_assert(sizeof...(Indices) <= 16, "multi_index only supports a maximum of 16 secondary indices");
+
+      name _code;
+      uint64_t _scope;
+      native::table_data* _table;
+      mutable std::map<uint64_t, std::unique_ptr<T>> _cache;
+
+      static std::vector<uint64_t> secondary_keys(const T& obj) {
+         return std::vector<uint64_t>{uint64_t(typename Indices::secondary_extractor_type{}(obj))...};
+      }
+
+      template<name::raw IndexName, std::size_t I = 0>
+      static constexpr std::size_t index_position() {
+         constexpr name::raw names[] = {Indices::index_name...};
+         static_assert(I < sizeof...(Indices), "name provided is not the name of any secondary indices within multi_index");
+         if constexpr (names[I] == IndexName) return I;
+         else return index_position<IndexName, I + 1>();
+      }
+
+      const T& load(uint64_t pk) const {
+         auto cached = _cache.find(pk);
+         if (cached != _cache.end()) return *cached->second;
+         auto& st = native::state();
+         st.count("db_get_i64");
+         auto it = _table->rows.find(pk);
+         check(it != _table->rows.end(), "unable to find key");
+         auto obj = std::make_unique<T>(unpack<T>(it->second.data));
+         const T& ref = *obj;
+         _cache.emplace(pk, std::move(obj));
+         return ref;
+      }
+
+      // Comme multi_index::find dans CDT : la ligne d'un index secondaire est
+      // retrouvée par sa clé primaire puis chargée si elle n'est pas en cache.
+      void fetch(uint64_t pk) const {
+         if (_cache.count(pk)) return;
+         native::state().count("db_find_i64");
+         load(pk);
+      }
+
+      void store(const T& obj, name payer) {
+         auto& st = native::state();
+         native::row r;
+         r.data = pack(obj);
+         r.secondary = secondary_keys(obj);
+         r.payer = payer.value;
+         st.write(*_table, obj.primary_key(), std::move(r));
+      }
+
+   public:
+      class const_iterator {
+      public:
+         using iterator_category = std::bidirectional_iterator_tag;
+         using value_type = T;
+         using difference_type = std::ptrdiff_t;
+         using pointer = const T*;
+         using reference = const T&;
+
+         const_iterator() = default;
+
+         const T& operator*() const { return _mi->load(_pk); }
+         const T* operator->() const { return &_mi->load(_pk); }
+
+         const_iterator& operator++() {
+            native::state().count("db_next_i64");
+            auto it = _mi->_table->rows.upper_bound(_pk);
+            if (it == _mi->_table->rows.end()) _end = true;
+            else { _pk = it->first; _mi->load(_pk); }
+            return *this;
+         }
+         const_iterator operator++(int) { auto tmp = *this; ++(*this); return tmp; }
+
+         const_iterator& operator--() {
+            native::state().count("db_previous_i64");
+            auto& rows = _mi->_table->rows;
+            auto it = _end ? rows.end() : rows.lower_bound(_pk);
+            check(it != rows.begin(), "cannot decrement iterator at beginning of table");
+            --it;
+            _pk = it->first;
+            _end = false;
+            _mi->load(_pk);
+            return *this;
+         }
+         const_iterator operator--(int) { auto tmp = *this; --(*this); return tmp; }
+
+         friend bool operator==(const const_iterator& a, const const_iterator& b) {
+            return a._end == b._end && (a._end || a._pk == b._pk);
+         }
+         friend bool operator!=(const const_iterator& a, const const_iterator& b) { return !(a == b); }
+
+      private:
+         friend class multi_index;
+         const_iterator(const multi_index* mi, uint64_t pk, bool end) : _mi(mi), _pk(pk), _end(end) {}
+         const multi_index* _mi = nullptr;
+         uint64_t _pk = 0;
+         bool _end = true;
+      };
+
+      template<std::size_t I, typename Extractor>
+      class index {
+      public:
+         class const_iterator {
+         public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T*;
+            using reference = const T&;
+
+            const_iterator() = default;
+
+            const T& operator*() const { return _mi->load(_pk); }
+            const T* operator->() const { return &_mi->load(_pk); }
+
+            const_iterator& operator++() {
+               native::state().count("db_idx64_next");
+               const auto& keys = _mi->keys<I>();
+               auto it = keys.upper_bound({_sec, _pk});
+               if (it == keys.end()) _end = true;
+               else { _sec = it->first; _pk = it->second; _mi->fetch(_pk); }
+               return *this;
+            }
+            const_iterator operator++(int) { auto tmp = *this; ++(*this); return tmp; }
+
+            friend bool operator==(const const_iterator& a, const const_iterator& b) {
+               return a._end == b._end && (a._end || (a._sec == b._sec && a._pk == b._pk));
+            }
+            friend bool operator!=(const const_iterator& a, const const_iterator& b) { return !(a == b); }
+
+         private:
+            friend class index;
+            const_iterator(const multi_index* mi, uint64_t sec, uint64_t pk, bool end) : _mi(mi), _sec(sec), _pk(pk), _end(end) {}
+            const multi_index* _mi = nullptr;
+            uint64_t _sec = 0;
+            uint64_t _pk = 0;
+            bool _end = true;
+         };
+
+         explicit index(multi_index* mi) : _mi(mi) {}
+
+         const_iterator begin() const { return lower_bound(0); }
+         const_iterator end() const { return const_iterator(_mi, 0, 0, true); }
+
+         const_iterator lower_bound(uint64_t secondary) const {
+            native::state().count("db_idx64_lowerbound");
+            return make(_mi->keys<I>().lower_bound({secondary, 0}));
+         }
+
+         const_iterator upper_bound(uint64_t secondary) const {
+            native::state().count("db_idx64_upperbound");
+            return make(_mi->keys<I>().upper_bound({secondary, UINT64_MAX}));
+         }
+
+         const_iterator find(uint64_t secondary) const {
+            auto itr = lower_bound(secondary);
+            if (itr == end() || itr._sec != secondary) return end();
+            return itr;
+         }
+
+         const_iterator iterator_to(const T& obj) const {
+            return const_iterator(_mi, Extractor{}(obj), obj.primary_key(), false);
+         }
+
+         template<typename Lambda>
+         void modify(const_iterator itr, name payer, Lambda&& updater) {
+            check(itr != end(), "cannot pass end iterator to modify");
+            _mi->modify(*itr, payer, std::forward<Lambda>(updater));
+         }
+
+         const_iterator erase(const_iterator itr) {
+            check(itr != end(), "cannot pass end iterator to erase");
+            const_iterator next = itr;
+            ++next;
+            _mi->erase(*itr);
+            return next;
+         }
+
+      private:
+         const_iterator make(std::set<std::pair<uint64_t, uint64_t>>::const_iterator it) const {
+            if (it == _mi->keys<I>().end()) return end();
+            _mi->fetch(it->second);
+            return const_iterator(_mi, it->first, it->second, false);
+         }
+
+         multi_index* _mi;
+      };
+
+      multi_index(name code, uint64_t scope)
+         : _code(code), _scope(scope), _table(&native::state().table(code.value, scope, uint64_t(TableName))) {
+         if (_table->secondary.size() < sizeof...(Indices)) _table->secondary.resize(sizeof...(Indices));
+      }
+
+      multi_index(const multi_index&) = delete;
+      multi_index& operator=(const multi_index&) = delete;
+
+      name get_code() const { return _code; }
+      uint64_t get_scope() const { return _scope; }
+
+      template<std::size_t I>
+      const std::set<std::pair<uint64_t, uint64_t>>& keys() const { return _table->secondary[I]; }
+
+   private:
+      // Comme CDT, qui charge la ligne dès qu'un itérateur y est positionné
+      // (load_object_by_primary_iterator), et non au déréférencement.
+      const_iterator loaded(std::map<uint64_t, native::row>::const_iterator it) const {
+         if (it == _table->rows.end()) return end();
+         load(it->first);
+         return const_iterator(this, it->first, false);
+      }
+
+   public:
+      const_iterator begin() const {
+         native::state().count("db_lowerbound_i64");
+         return loaded(_table->rows.begin());
+      }
+
+      const_iterator end() const { return const_iterator(this, 0, true); }
+
+      const_iterator lower_bound(uint64_t primary) const {
+         native::state().count("db_lowerbound_i64");
+         return loaded(_table->rows.lower_bound(primary));
+      }
+
+      const_iterator upper_bound(uint64_t primary) const {
+         native::state().count("db_upperbound_i64");
+         return loaded(_table->rows.upper_bound(primary));
+      }
+
+      const_iterator find(uint64_t primary) const {
+         if (_cache.count(primary)) return const_iterator(this, primary, false);
+         native::state().count("db_find_i64");
+         return loaded(_table->rows.find(primary));
+      }
+
+      const T& get(uint64_t primary, const char* error_msg = "unable to find key") const {
+         auto itr = find(primary);
+         check(itr != end(), error_msg);
+         return *itr;
+      }
+
+      const_iterator require_find(uint64_t primary, const char* error_msg = "unable to find key") const {
+         auto itr = find(primary);
+         check(itr != end(), error_msg);
+         return itr;
+      }
+
+      const_iterator iterator_to(const T& obj) const { return const_iterator(this, obj.primary_key(), false); }
+
+      uint64_t available_primary_key() const {
+         return _table->rows.empty() ? 0 : _table->rows.rbegin()->first + 1;
+      }
+
+      template<name::raw IndexName>
+      auto get_index() {
+         constexpr std::size_t pos = index_position<IndexName>();
+         using extractor = typename std::tuple_element_t<pos, std::tuple<Indices...>>::secondary_extractor_type;
+         return index<pos, extractor>(this);
+      }
+
+      template<typename Lambda>
+      const_iterator emplace(name payer, Lambda&& constructor) {
+         auto obj = std::make_unique<T>();
+         constructor(*obj);
+         const uint64_t pk = obj->primary_key();
+         check(!_table->rows.count(pk), "could not insert object, most likely a uniqueness constraint was violated");
+         auto& st = native::state();
+         st.count("db_store_i64");
+         for (std::size_t i = 0; i < sizeof...(Indices); ++i) st.count("db_idx64_store");
+         store(*obj, payer);
+         _cache[pk] = std::move(obj);
+         return const_iterator(this, pk, false);
+      }
+
+      template<typename Lambda>
+      void modify(const_iterator itr, name payer, Lambda&& updater) {
+         check(itr != end(), "cannot pass end iterator to modify");
+         modify(*itr, payer, std::forward<Lambda>(updater));
+      }
+
+      template<typename Lambda>
+      void modify(const T& obj, name payer, Lambda&& updater) {
+         T& mutable_obj = const_cast<T&>(obj);
+         const uint64_t pk = obj.primary_key();
+         const auto before = secondary_keys(obj);
+         updater(mutable_obj);
+         check(pk == mutable_obj.primary_key(), "updater cannot change primary key when modifying an object");
+         auto& st = native::state();
+         st.count("db_update_i64");
+         const auto after = secondary_keys(mutable_obj);
+         for (std::size_t i = 0; i < after.size(); ++i)
+            if (before[i] != after[i]) st.count("db_idx64_update");
+         store(mutable_obj, payer);
+      }
+
+      const_iterator erase(const_iterator itr) {
+         check(itr != end(), "cannot pass end iterator to erase");
+         const_iterator next = itr;
+         ++next;
+         erase(*itr);
+         return next;
+      }
+
+      void erase(const T& obj) {
+         const uint64_t pk = obj.primary_key();
+         auto& st = native::state();
+         st.count("db_remove_i64");
+         for (std::size_t i = 0; i < sizeof...(Indices); ++i) st.count("db_idx64_remove");
+         st.write(*_table, pk, std::nullopt);
+         _cache.erase(pk);
+      }
+   };
+
+}
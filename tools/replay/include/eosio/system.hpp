@@ -0,0 +1,16 @@
+// Doublure native : horloge de la chaîne simulée.
+#pragma once
+
+#include <eosio/eosio.hpp>
+
+namespace eosio {
+
+   inline time_point current_time_point() {
+      return time_point(microseconds(native::state().now_us));
+   }
+
+   inline time_point_sec current_block_time() {
+      return time_point_sec(current_time_point());
+   }
+
+}
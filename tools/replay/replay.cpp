@@ -0,0 +1,592 @@
+// Rejeu natif de traces d'actions de production contre mycontract.
+//
+// Le contrat est compilé tel quel contre la doublure en mémoire de eosio.cdt
+// (tools/replay/include), puis chaque action de la trace est exécutée dans
+// l'ordre. Une action qui échoue est annulée comme sur la chaîne. À la fin,
+// l'outil affiche par type d'action : nombre d'appels, échecs, percentiles de
+// latence, appels aux intrinsèques de base de données ; puis une empreinte de
+// chaque table et de l'état complet, pour vérifier qu'une optimisation ne
+// change pas l'état final. Les valeurs de retour (pages d'exportpage) ont leur
+// propre empreinte, puisqu'une action en lecture seule ne modifie aucune table.
+//
+// Compilation (depuis tools/replay) :
+//   g++ -std=c++17 -O2 -Wno-attributes -Iinclude -o replay replay.cpp
+//
+// Usage :
+//   replay [--contract compte] [--ops] trace.json...
+//
+// Une trace est un tableau JSON d'actions, par exemple :
+//   [{"name": "addplayers", "authorization": [{"actor": "mycontract", "permission": "active"}],
+//     "timestamp": "2024-03-25T12:00:00.000", "data": {"players_details": [...]}}]
+// Les entrées au format Hyperion ({"@timestamp": ..., "act": {"name": ..., "data": ...}})
+// sont aussi acceptées. Le compte d'une action est lu dans "account" (celui du contrat par
+// défaut) : un transfer de alien.worlds est rejoué comme notification (on_transfer), les
+// actions des autres comptes (eosio.token, ...) sont ignorées et comptées à part.
+#include "../../smart_contract.cpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+   // ---------------------------------------------------------------------
+   // JSON minimal (les nombres sont conservés sous forme de texte pour les uint64)
+   // ---------------------------------------------------------------------
+
+   struct json {
+      enum kind_t { null_value, boolean, number, string, array, object } kind = null_value;
+      bool b = false;
+      std::string s;
+      std::vector<json> a;
+      std::vector<std::pair<std::string, json>> o;
+
+      const json* get(const std::string& key) const {
+         for (const auto& [k, v] : o)
+            if (k == key) return &v;
+         return nullptr;
+      }
+
+      const json& at(const std::string& key) const {
+         const json* v = get(key);
+         if (!v) throw std::runtime_error("missing field '" + key + "'");
+         return *v;
+      }
+   };
+
+   class json_parser {
+   public:
+      explicit json_parser(const std::string& text) : _p(text.data()), _end(text.data() + text.size()) {}
+
+      json parse() {
+         json v = value();
+         ws();
+         if (_p != _end) fail("trailing characters");
+         return v;
+      }
+
+   private:
+      [[noreturn]] void fail(const char* what) { throw std::runtime_error(std::string("invalid JSON: ") + what); }
+
+      void ws() {
+         while (_p != _end && (*_p == ' ' || *_p == '\n' || *_p == '\r' || *_p == '\t')) ++_p;
+      }
+
+      bool literal(const char* word) {
+         const std::size_t n = std::strlen(word);
+         if (std::size_t(_end - _p) < n || std::strncmp(_p, word, n) != 0) return false;
+         _p += n;
+         return true;
+      }
+
+      json value() {
+         ws();
+         if (_p == _end) fail("unexpected end");
+         json v;
+         switch (*_p) {
+            case '{': {
+               v.kind = json::object;
+               ++_p;
+               ws();
+               if (_p != _end && *_p == '}') { ++_p; return v; }
+               for (;;) {
+                  ws();
+                  std::string key = str();
+                  ws();
+                  if (_p == _end || *_p++ != ':') fail("expected ':'");
+                  v.o.emplace_back(std::move(key), value());
+                  ws();
+                  if (_p == _end) fail("unterminated object");
+                  if (*_p == ',') { ++_p; continue; }
+                  if (*_p++ != '}') fail("expected '}'");
+                  return v;
+               }
+            }
+            case '[': {
+               v.kind = json::array;
+               ++_p;
+               ws();
+               if (_p != _end && *_p == ']') { ++_p; return v; }
+               for (;;) {
+                  v.a.push_back(value());
+                  ws();
+                  if (_p == _end) fail("unterminated array");
+                  if (*_p == ',') { ++_p; continue; }
+                  if (*_p++ != ']') fail("expected ']'");
+                  return v;
+               }
+            }
+            case '"':
+               v.kind = json::string;
+               v.s = str();
+               return v;
+            default:
+               if (literal("true")) { v.kind = json::boolean; v.b = true; return v; }
+               if (literal("false")) { v.kind = json::boolean; return v; }
+               if (literal("null")) return v;
+               v.kind = json::number;
+               while (_p != _end && (std::isdigit(static_cast<unsigned char>(*_p)) || *_p == '-' || *_p == '+' || *_p == '.' || *_p == 'e' || *_p == 'E'))
+                  v.s.push_back(*_p++);
+               if (v.s.empty()) fail("unexpected character");
+               return v;
+         }
+      }
+
+      std::string str() {
+         if (_p == _end || *_p != '"') fail("expected string");
+         ++_p;
+         std::string out;
+         while (_p != _end && *_p != '"') {
+            if (*_p != '\\') { out.push_back(*_p++); continue; }
+            if (++_p == _end) fail("unterminated escape");
+            const char c = *_p++;
+            switch (c) {
+               case 'n': out.push_back('\n'); break;
+               case 't': out.push_back('\t'); break;
+               case 'r': out.push_back('\r'); break;
+               case 'b': out.push_back('\b'); break;
+               case 'f': out.push_back('\f'); break;
+               case 'u': {
+                  if (_end - _p < 4) fail("bad unicode escape");
+                  const unsigned cp = std::stoul(std::string(_p, 4), nullptr, 16);
+                  _p += 4;
+                  if (cp < 0x80) out.push_back(char(cp));
+                  else if (cp < 0x800) { out.push_back(char(0xC0 | (cp >> 6))); out.push_back(char(0x80 | (cp & 0x3F))); }
+                  else { out.push_back(char(0xE0 | (cp >> 12))); out.push_back(char(0x80 | ((cp >> 6) & 0x3F))); out.push_back(char(0x80 | (cp & 0x3F))); }
+                  break;
+               }
+               default: out.push_back(c);
+            }
+         }
+         if (_p == _end) fail("unterminated string");
+         ++_p;
+         return out;
+      }
+
+      const char* _p;
+      const char* _end;
+   };
+
+   // ---------------------------------------------------------------------
+   // Conversion des données JSON vers les paramètres des actions
+   // ---------------------------------------------------------------------
+
+   uint64_t to_u64(const json& v) {
+      if (v.kind != json::number && v.kind != json::string) throw std::runtime_error("expected an integer");
+      return std::stoull(v.s);
+   }
+
+   name to_name(const json& v) {
+      if (v.kind != json::string) throw std::runtime_error("expected a name");
+      return name(std::string_view(v.s));
+   }
+
+   asset to_asset(const json& v) {
+      if (v.kind != json::string) throw std::runtime_error("expected an asset");
+      const auto space = v.s.find(' ');
+      if (space == std::string::npos) throw std::runtime_error("invalid asset '" + v.s + "'");
+
+      const std::string amount = v.s.substr(0, space);
+      const auto dot = amount.find('.');
+      const uint8_t precision = dot == std::string::npos ? 0 : uint8_t(amount.size() - dot - 1);
+      std::string digits = amount;
+      if (dot != std::string::npos) digits.erase(dot, 1);
+      return asset(std::stoll(digits), symbol(std::string_view(v.s).substr(space + 1), precision));
+   }
+
+   template<typename T, typename F>
+   std::optional<T> optional_field(const json& data, const char* key, F convert) {
+      const json* v = data.get(key);
+      if (!v || v->kind == json::null_value) return std::nullopt;
+      return convert(*v);
+   }
+
+   // Convertit une date ISO 8601 (UTC) ou un nombre de secondes en microsecondes depuis l'époque
+   int64_t to_time_us(const json& v) {
+      if (v.kind == json::number) return int64_t(std::stod(v.s) * 1000000);
+      int y = 0, mo = 0, d = 0, h = 0, mi = 0;
+      double sec = 0;
+      if (std::sscanf(v.s.c_str(), "%d-%d-%dT%d:%d:%lf", &y, &mo, &d, &h, &mi, &sec) != 6)
+         throw std::runtime_error("invalid timestamp '" + v.s + "'");
+
+      // Nombre de jours depuis 1970-01-01 (algorithme de H. Hinnant)
+      y -= mo <= 2;
+      const int era = (y >= 0 ? y : y - 399) / 400;
+      const unsigned yoe = unsigned(y - era * 400);
+      const unsigned doy = (153 * (mo + (mo > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+      const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+      const int64_t days = int64_t(era) * 146097 + int64_t(doe) - 719468;
+
+      return (days * 86400 + h * 3600 + mi * 60) * 1000000 + int64_t(sec * 1000000);
+   }
+
+   // Une action de la trace, prête à être exécutée
+   struct replay_step {
+      std::string type;
+      name first_receiver;
+      std::set<uint64_t> authorizers;
+      int64_t time_us = -1;
+      std::function<void(mycontract&)> call;
+   };
+
+   using decoder = std::function<void(mycontract&)> (*)(const json&);
+
+   const std::map<std::string, decoder>& decoders() {
+      static const std::map<std::string, decoder> table = {
+         {"addowners", [](const json& d) -> std::function<void(mycontract&)> {
+            std::vector<mycontract::OwnerDetails> details;
+            for (const auto& o : d.at("owner_details").a) {
+               details.push_back({to_name(o.at("owner")), to_u64(o.at("land_id")),
+                                  to_u64(o.at("totalDefense")), to_u64(o.at("totalDefenseArm")),
+                                  to_u64(o.at("totalAttack")), to_u64(o.at("totalAttackArm")),
+                                  to_u64(o.at("totalMoveCost"))});
+            }
+            return [details](mycontract& c) { c.addowners(details); };
+         }},
+         {"modifyowner", [](const json& d) -> std::function<void(mycontract&)> {
+            const name owner = to_name(d.at("owner"));
+            const auto land_id = optional_field<uint64_t>(d, "land_id", to_u64);
+            const auto defense = optional_field<uint64_t>(d, "totalDefense", to_u64);
+            const auto defense_arm = optional_field<uint64_t>(d, "totalDefenseArm", to_u64);
+            const auto attack = optional_field<uint64_t>(d, "totalAttack", to_u64);
+            const auto attack_arm = optional_field<uint64_t>(d, "totalAttackArm", to_u64);
+            const auto move_cost = optional_field<uint64_t>(d, "totalMoveCost", to_u64);
+            return [=](mycontract& c) { c.modifyowner(owner, land_id, defense, defense_arm, attack, attack_arm, move_cost); };
+         }},
+         {"removeland", [](const json& d) -> std::function<void(mycontract&)> {
+            const name owner = to_name(d.at("owner"));
+            const uint64_t land_id = to_u64(d.at("land_id"));
+            return [=](mycontract& c) { c.removeland(owner, land_id); };
+         }},
+         {"removelands", [](const json& d) -> std::function<void(mycontract&)> {
+            std::vector<mycontract::LandRemoval> lands;
+            for (const auto& l : d.at("lands").a) lands.push_back({to_name(l.at("owner")), to_u64(l.at("land_id"))});
+            return [lands](mycontract& c) { c.removelands(lands); };
+         }},
+         {"removeplayer", [](const json& d) -> std::function<void(mycontract&)> {
+            const name player = to_name(d.at("player"));
+            return [=](mycontract& c) { c.removeplayer(player); };
+         }},
+         {"purge", [](const json& d) -> std::function<void(mycontract&)> {
+            const uint32_t max_rows = uint32_t(to_u64(d.at("max_rows")));
+            return [=](mycontract& c) { c.purge(max_rows); };
+         }},
+         {"addplayers", [](const json& d) -> std::function<void(mycontract&)> {
+            std::vector<mycontract::PlayerDetails> details;
+            for (const auto& p : d.at("players_details").a) {
+               details.push_back({to_name(p.at("player_address")),
+                                  to_u64(p.at("totalDefense")), to_u64(p.at("totalDefenseArm")),
+                                  to_u64(p.at("totalAttack")), to_u64(p.at("totalAttackArm")),
+                                  to_u64(p.at("totalMoveCost"))});
+            }
+            return [details](mycontract& c) { c.addplayers(details); };
+         }},
+         {"addplayer", [](const json& d) -> std::function<void(mycontract&)> {
+            const name player = to_name(d.at("player_address"));
+            const uint64_t defense = to_u64(d.at("totalDefense")), defense_arm = to_u64(d.at("totalDefenseArm"));
+            const uint64_t attack = to_u64(d.at("totalAttack")), attack_arm = to_u64(d.at("totalAttackArm"));
+            const uint64_t move_cost = to_u64(d.at("totalMoveCost"));
+            return [=](mycontract& c) { c.addplayer(player, defense, defense_arm, attack, attack_arm, move_cost); };
+         }},
+         {"addchest", [](const json& d) -> std::function<void(mycontract&)> {
+            const uint64_t land_id = to_u64(d.at("land_id"));
+            const name owner = to_name(d.at("owner"));
+            const uint64_t level = to_u64(d.at("chest_level")), tlm = to_u64(d.at("TLM"));
+            return [=](mycontract& c) { c.addchest(land_id, owner, level, tlm); };
+         }},
+         {"modifychest", [](const json& d) -> std::function<void(mycontract&)> {
+            const uint64_t land_id = to_u64(d.at("land_id"));
+            const auto new_owner = optional_field<name>(d, "new_owner", to_name);
+            const auto new_level = optional_field<uint64_t>(d, "new_level", to_u64);
+            const auto new_tlm = optional_field<uint64_t>(d, "new_tlm", to_u64);
+            const auto withdraw = optional_field<uint64_t>(d, "tlm_to_withdraw", to_u64);
+            return [=](mycontract& c) { c.modifychest(land_id, new_owner, new_level, new_tlm, withdraw); };
+         }},
+         {"addsupport", [](const json& d) -> std::function<void(mycontract&)> {
+            const name player = to_name(d.at("player")), new_owner = to_name(d.at("new_owner"));
+            return [=](mycontract& c) { c.addsupport(player, new_owner); };
+         }},
+         {"createmis", [](const json& d) -> std::function<void(mycontract&)> {
+            const name mission = to_name(d.at("mission_name"));
+            const uint64_t target = to_u64(d.at("target_attack_points"));
+            const asset reward = to_asset(d.at("reward"));
+            const uint32_t deadline = uint32_t(to_u64(d.at("deadline_seconds")));
+            return [=](mycontract& c) { c.createmis(mission, target, reward, deadline); };
+         }},
+         {"hardenmiss", [](const json&) -> std::function<void(mycontract&)> {
+            return [](mycontract& c) { c.hardenmiss(); };
+         }},
+         {"sendattack", [](const json& d) -> std::function<void(mycontract&)> {
+            const name player = to_name(d.at("player")), mission = to_name(d.at("mission_name"));
+            return [=](mycontract& c) { c.sendattack(player, mission); };
+         }},
+         {"distributere", [](const json& d) -> std::function<void(mycontract&)> {
+            const name mission = to_name(d.at("mission_name"));
+            return [=](mycontract& c) { c.distributere(mission); };
+         }},
+         {"addforge", [](const json& d) -> std::function<void(mycontract&)> {
+            const name player = to_name(d.at("player"));
+            return [=](mycontract& c) { c.addforge(player); };
+         }},
+         {"exportpage", [](const json& d) -> std::function<void(mycontract&)> {
+            const name table = to_name(d.at("table"));
+            const auto scope = optional_field<name>(d, "scope", to_name);
+            const uint64_t cursor = to_u64(d.at("cursor"));
+            const uint32_t limit = uint32_t(to_u64(d.at("limit")));
+            return [=](mycontract& c) { set_action_return_value(c.exportpage(table, scope.value_or(name()), cursor, limit)); };
+         }},
+         {"on_transfer", [](const json& d) -> std::function<void(mycontract&)> {
+            const name from = to_name(d.at("from")), to = to_name(d.at("to"));
+            const asset quantity = to_asset(d.at("quantity"));
+            const std::string memo = d.get("memo") ? d.at("memo").s : std::string();
+            return [=](mycontract& c) { c.on_transfer(from, to, quantity, memo); };
+         }},
+      };
+      return table;
+   }
+
+   // Renvoie std::nullopt pour une action qui n'est ni une action du contrat ni
+   // un transfert de TLM notifié au contrat
+   std::optional<replay_step> make_step(const json& entry, name contract_account) {
+      const json& act = entry.get("act") ? entry.at("act") : entry;
+
+      replay_step step;
+      step.type = act.at("name").s;
+      step.first_receiver = contract_account;
+
+      name account = contract_account;
+      if (const json* a = act.get("account")) account = to_name(*a);
+      else if (const json* a = entry.get("account")) account = to_name(*a);
+
+      if (step.type == "transfer" && account == "alien.worlds"_n) {
+         // Notification d'un transfert de TLM
+         step.type = "on_transfer";
+         step.first_receiver = account;
+      } else if (step.type == "on_transfer") {
+         step.first_receiver = "alien.worlds"_n;
+      } else if (account != contract_account) {
+         return std::nullopt;
+      }
+
+      if (const json* auths = act.get("authorization")) {
+         for (const auto& a : auths->a) step.authorizers.insert(to_name(a.at("actor")).value);
+      } else {
+         step.authorizers.insert(contract_account.value);
+      }
+
+      for (const char* key : {"timestamp", "@timestamp", "block_time"}) {
+         if (const json* t = entry.get(key)) {
+            step.time_us = to_time_us(*t);
+            break;
+         }
+      }
+
+      auto d = decoders().find(step.type);
+      if (d == decoders().end()) throw std::runtime_error("unsupported action '" + step.type + "'");
+      json no_data;
+      no_data.kind = json::object;
+      const json* data = act.get("data");
+      step.call = d->second(data ? *data : no_data);
+      return step;
+   }
+
+   // ---------------------------------------------------------------------
+   // Statistiques
+   // ---------------------------------------------------------------------
+
+   struct action_stats {
+      uint64_t calls = 0;
+      uint64_t failures = 0;
+      std::vector<double> latencies_us;
+      std::map<std::string, uint64_t> db_ops;
+      std::map<std::string, uint64_t> errors;
+   };
+
+   double percentile(std::vector<double>& sorted, double p) {
+      if (sorted.empty()) return 0;
+      const std::size_t rank = std::size_t(std::ceil(p / 100.0 * double(sorted.size())));
+      return sorted[std::min(sorted.size(), std::max<std::size_t>(rank, 1)) - 1];
+   }
+
+   uint64_t fnv1a(uint64_t h, const void* data, std::size_t n) {
+      const auto* p = static_cast<const unsigned char*>(data);
+      for (std::size_t i = 0; i < n; ++i) {
+         h ^= p[i];
+         h *= 0x100000001b3ULL;
+      }
+      return h;
+   }
+
+   std::string hex64(uint64_t v) {
+      std::ostringstream os;
+      os << std::hex << std::setw(16) << std::setfill('0') << v;
+      return os.str();
+   }
+
+   std::string read_file(const std::string& path) {
+      std::ifstream file(path, std::ios::binary);
+      if (!file) throw std::runtime_error("cannot open " + path);
+      return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+   }
+
+}
+
+int main(int argc, char** argv) {
+   name contract_account = "mycontract"_n;
+   bool show_ops = false;
+   std::vector<std::string> traces;
+
+   for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      if (arg == "--contract" && i + 1 < argc) contract_account = name(std::string_view(argv[++i]));
+      else if (arg == "--ops") show_ops = true;
+      else traces.push_back(arg);
+   }
+   if (traces.empty()) {
+      std::cerr << "usage: " << argv[0] << " [--contract account] [--ops] trace.json...\n";
+      return 2;
+   }
+
+   // Décodage complet des traces avant le rejeu, pour ne mesurer que le contrat
+   std::vector<replay_step> steps;
+   uint64_t skipped = 0;
+   try {
+      for (const auto& path : traces) {
+         const json trace = json_parser(read_file(path)).parse();
+         if (trace.kind != json::array) throw std::runtime_error(path + ": a trace must be a JSON array");
+         for (std::size_t i = 0; i < trace.a.size(); ++i) {
+            try {
+               if (auto step = make_step(trace.a[i], contract_account)) steps.push_back(std::move(*step));
+               else ++skipped;
+            } catch (const std::exception& e) {
+               throw std::runtime_error(path + " entry " + std::to_string(i) + ": " + e.what());
+            }
+         }
+      }
+   } catch (const std::exception& e) {
+      std::cerr << "error: " << e.what() << '\n';
+      return 1;
+   }
+
+   auto& chain = native::state();
+   chain.now_us = int64_t(1704067200) * 1000000; // 2024-01-01T00:00:00 si la trace n'est pas datée
+
+   std::map<std::string, action_stats> stats;
+   uint64_t inline_actions = 0;
+   uint64_t return_values = 0;
+   uint64_t return_hash = 0xcbf29ce484222325ULL;
+
+   for (const auto& step : steps) {
+      chain.now_us = step.time_us >= 0 ? step.time_us : chain.now_us + 500000;
+      chain.begin_action(step.authorizers);
+      const auto ops_before = chain.db_ops;
+
+      auto& s = stats[step.type];
+      ++s.calls;
+
+      const auto start = std::chrono::steady_clock::now();
+      try {
+         mycontract c(contract_account, step.first_receiver, datastream<const char*>(nullptr, 0));
+         step.call(c);
+         inline_actions += chain.inline_actions.size();
+         if (!chain.return_value.empty()) {
+            return_hash = fnv1a(return_hash, chain.return_value.data(), chain.return_value.size());
+            ++return_values;
+         }
+      } catch (const eosio_assert_exception& e) {
+         chain.rollback();
+         ++s.failures;
+         ++s.errors[e.what()];
+      } catch (const std::exception& e) {
+         // Toute autre exception (désérialisation, std::out_of_range, ...) fait aussi échouer la transaction
+         chain.rollback();
+         ++s.failures;
+         ++s.errors[std::string("exception: ") + e.what()];
+      }
+      const auto stop = std::chrono::steady_clock::now();
+      s.latencies_us.push_back(std::chrono::duration<double, std::micro>(stop - start).count());
+
+      for (const auto& [op, count] : chain.db_ops) {
+         auto before = ops_before.find(op);
+         s.db_ops[op] += count - (before == ops_before.end() ? 0 : before->second);
+      }
+   }
+
+   // Rapport par type d'action
+   std::cout << "actions: " << steps.size() << ", inline actions: " << inline_actions
+             << ", skipped (other accounts): " << skipped << "\n\n";
+   std::cout << std::left << std::setw(14) << "action" << std::right
+             << std::setw(9) << "calls" << std::setw(9) << "failed"
+             << std::setw(11) << "p50 us" << std::setw(11) << "p90 us" << std::setw(11) << "p99 us" << std::setw(11) << "max us"
+             << std::setw(12) << "db ops" << std::setw(12) << "db ops/call" << '\n';
+   std::cout << std::fixed << std::setprecision(1);
+   for (auto& [type, s] : stats) {
+      std::sort(s.latencies_us.begin(), s.latencies_us.end());
+      uint64_t total_ops = 0;
+      for (const auto& [op, count] : s.db_ops)
+         if (op != "send_inline") total_ops += count;
+      std::cout << std::left << std::setw(14) << type << std::right
+                << std::setw(9) << s.calls << std::setw(9) << s.failures
+                << std::setw(11) << percentile(s.latencies_us, 50) << std::setw(11) << percentile(s.latencies_us, 90)
+                << std::setw(11) << percentile(s.latencies_us, 99) << std::setw(11) << s.latencies_us.back()
+                << std::setw(12) << total_ops << std::setw(12) << double(total_ops) / double(s.calls) << '\n';
+   }
+
+   if (show_ops) {
+      std::cout << "\ndb ops by action:\n";
+      for (const auto& [type, s] : stats) {
+         std::cout << "  " << type << ':';
+         for (const auto& [op, count] : s.db_ops)
+            if (count) std::cout << ' ' << op << '=' << count;
+         std::cout << '\n';
+      }
+   }
+
+   bool any_error = false;
+   for (const auto& [type, s] : stats) {
+      for (const auto& [message, count] : s.errors) {
+         if (!any_error) std::cout << "\nfailures:\n";
+         any_error = true;
+         std::cout << "  " << type << " x" << count << ": " << message << '\n';
+      }
+   }
+
+   // Empreintes de l'état final : par table (toutes scopes confondues) puis globale
+   std::map<std::string, std::pair<uint64_t, uint64_t>> table_hashes; // nom -> (lignes, empreinte)
+   uint64_t state_hash = 0xcbf29ce484222325ULL;
+   for (const auto& [id, table] : chain.tables) {
+      if (table.rows.empty()) continue;
+      auto& [rows, h] = table_hashes.try_emplace(name(id.table).to_string(), 0, 0xcbf29ce484222325ULL).first->second;
+      for (const auto& [primary, row] : table.rows) {
+         for (uint64_t* hash : {&h, &state_hash}) {
+            *hash = fnv1a(*hash, &id.scope, sizeof(id.scope));
+            *hash = fnv1a(*hash, &primary, sizeof(primary));
+            *hash = fnv1a(*hash, row.data.data(), row.data.size());
+         }
+         ++rows;
+      }
+      state_hash = fnv1a(state_hash, &id.table, sizeof(id.table));
+   }
+
+   std::cout << "\nfinal state:\n";
+   for (const auto& [table, entry] : table_hashes) {
+      std::cout << "  " << std::left << std::setw(14) << table << std::right << std::setw(9) << entry.first
+                << " rows  " << hex64(entry.second) << '\n';
+   }
+   std::cout << "  state hash " << hex64(state_hash) << '\n';
+   std::cout << "  return value hash " << hex64(return_hash) << " (" << return_values << " values)\n";
+   return 0;
+}
@@ -0,0 +1,268 @@
+// Décodeur natif des pages renvoyées par l'action exportpage de mycontract.
+//
+// Chaque page contient l'en-tête (schema_version, table, scope, row_count,
+// more, next_cursor) suivi des lignes de la table dans leur format binaire de
+// stockage. Le décodeur écrit une ligne JSON par ligne de table sur la sortie
+// standard, prête à être chargée dans une base d'analyse, et le curseur de
+// reprise de la dernière page de chaque table sur la sortie d'erreur.
+//
+// Compilation : g++ -std=c++17 -O2 -o snapshot_decoder snapshot_decoder.cpp
+//
+// Usage :
+//   snapshot_decoder [--binary] fichier...
+//
+// Par défaut chaque fichier contient une page par ligne en hexadécimal
+// (return_value_hex_data d'une transaction en lecture seule). Avec --binary,
+// les fichiers contiennent des pages binaires mises bout à bout.
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+   // Doit correspondre à EXPORT_SCHEMA_VERSION dans smart_contract.cpp
+   constexpr uint32_t SUPPORTED_SCHEMA_VERSION = 1;
+
+   enum class field_type { u8, u64, boolean, account, asset, time_point_sec, u64_list, account_list };
+
+   struct field {
+      const char* name;
+      field_type type;
+   };
+
+   // Structure des tables du contrat pour SUPPORTED_SCHEMA_VERSION, dans l'ordre des champs
+   const std::map<std::string, std::vector<field>>& table_schemas() {
+      static const std::map<std::string, std::vector<field>> schemas = {
+         {"owners", {{"owner_address", field_type::account}, {"land_ids", field_type::u64_list},
+                     {"totalDefense", field_type::u64}, {"totalDefenseArm", field_type::u64},
+                     {"totalAttack", field_type::u64}, {"totalAttackArm", field_type::u64},
+                     {"totalMoveCost", field_type::u64}, {"numberofland", field_type::u64}}},
+         {"players", {{"player_address", field_type::account},
+                      {"totalDefense", field_type::u64}, {"totalDefenseArm", field_type::u64},
+                      {"totalAttack", field_type::u64}, {"totalAttackArm", field_type::u64},
+                      {"totalMoveCost", field_type::u64}}},
+         {"supports", {{"owner_address", field_type::account}, {"supporters", field_type::account_list},
+                       {"total_defense_score", field_type::u64}, {"total_attack_score", field_type::u64},
+                       {"totalMoveCost", field_type::u64}}},
+         {"forge", {{"player_address", field_type::account}}},
+         {"chests", {{"land_id", field_type::u64}, {"owner", field_type::account},
+                     {"chest_level", field_type::u64}, {"TLM", field_type::u64}}},
+         {"missions", {{"mission_name", field_type::account}, {"target_attack_points", field_type::u64},
+                       {"reward", field_type::asset}, {"is_completed", field_type::boolean},
+                       {"total_attack_points", field_type::u64}, {"last_hardening_time", field_type::u64},
+                       {"is_distributed", field_type::boolean}, {"deadline", field_type::time_point_sec}}},
+         {"attackshards", {{"shard", field_type::u64}, {"attack_points", field_type::u64}, {"quota", field_type::u64}}},
+         {"playermiss", {{"id", field_type::u64}, {"mission_name", field_type::account},
+                         {"player", field_type::account}, {"attack_points", field_type::u64},
+                         {"last_participation_time", field_type::u64}}},
+         {"members", {{"player_name", field_type::account}}},
+         {"purges", {{"account", field_type::account}, {"roles", field_type::u8}, {"stage", field_type::u8}, {"cursor", field_type::u64}}},
+      };
+      return schemas;
+   }
+
+   std::string name_to_string(uint64_t value) {
+      static const char* charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+      std::string str(13, '.');
+      uint64_t tmp = value;
+      for (uint32_t i = 0; i <= 12; ++i) {
+         str[12 - i] = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
+         tmp >>= (i == 0 ? 4 : 5);
+      }
+      const auto last = str.find_last_not_of('.');
+      str.erase(last == std::string::npos ? 0 : last + 1);
+      return str;
+   }
+
+   std::string asset_to_string(int64_t amount, uint64_t sym) {
+      const uint8_t precision = uint8_t(sym & 0xFF);
+      std::string code;
+      for (uint64_t v = sym >> 8; v > 0; v >>= 8) code.push_back(char(v & 0xFF));
+
+      const bool negative = amount < 0;
+      std::string digits = std::to_string(negative ? uint64_t(-amount) : uint64_t(amount));
+      if (precision > 0) {
+         if (digits.size() <= precision) digits.insert(0, precision - digits.size() + 1, '0');
+         digits.insert(digits.size() - precision, 1, '.');
+      }
+      return (negative ? "-" : "") + digits + " " + code;
+   }
+
+   class reader {
+   public:
+      reader(const char* begin, const char* end) : _pos(begin), _end(end) {}
+
+      bool empty() const { return _pos == _end; }
+      const char* pos() const { return _pos; }
+
+      template<typename T>
+      T read() {
+         T v;
+         take(&v, sizeof(T));
+         return v;
+      }
+
+      uint32_t varuint32() {
+         uint32_t v = 0;
+         uint8_t shift = 0;
+         uint8_t b = 0;
+         do {
+            b = read<uint8_t>();
+            v |= uint32_t(b & 0x7F) << shift;
+            shift += 7;
+         } while ((b & 0x80) && shift < 35);
+         return v;
+      }
+
+      const char* skip(std::size_t n) {
+         if (std::size_t(_end - _pos) < n) throw std::runtime_error("truncated page");
+         const char* start = _pos;
+         _pos += n;
+         return start;
+      }
+
+   private:
+      void take(void* dst, std::size_t n) { std::memcpy(dst, skip(n), n); }
+
+      const char* _pos;
+      const char* _end;
+   };
+
+   void write_field(std::ostream& out, reader& in, field_type type) {
+      switch (type) {
+         case field_type::u8: out << unsigned(in.read<uint8_t>()); break;
+         case field_type::u64: out << in.read<uint64_t>(); break;
+         case field_type::boolean: out << (in.read<uint8_t>() ? "true" : "false"); break;
+         case field_type::account: out << '"' << name_to_string(in.read<uint64_t>()) << '"'; break;
+         case field_type::time_point_sec: out << in.read<uint32_t>(); break;
+         case field_type::asset: {
+            const int64_t amount = in.read<int64_t>();
+            const uint64_t sym = in.read<uint64_t>();
+            out << '"' << asset_to_string(amount, sym) << '"';
+            break;
+         }
+         case field_type::u64_list:
+         case field_type::account_list: {
+            const uint32_t n = in.varuint32();
+            out << '[';
+            for (uint32_t i = 0; i < n; ++i) {
+               if (i) out << ',';
+               write_field(out, in, type == field_type::u64_list ? field_type::u64 : field_type::account);
+            }
+            out << ']';
+            break;
+         }
+      }
+   }
+
+   // Décode une page et renvoie le nombre de lignes écrites
+   uint32_t decode_page(reader& in, std::ostream& out, std::map<std::string, std::string>& cursors) {
+      const uint32_t version = in.read<uint32_t>();
+      if (version != SUPPORTED_SCHEMA_VERSION) {
+         throw std::runtime_error("unsupported schema version " + std::to_string(version));
+      }
+      const std::string table = name_to_string(in.read<uint64_t>());
+      const std::string scope = name_to_string(in.read<uint64_t>());
+      const uint32_t row_count = in.read<uint32_t>();
+      const bool more = in.read<uint8_t>() != 0;
+      const uint64_t next_cursor = in.read<uint64_t>();
+      const uint32_t rows_size = in.varuint32();
+      const char* rows = in.skip(rows_size);
+
+      auto schema = table_schemas().find(table);
+      if (schema == table_schemas().end()) throw std::runtime_error("unknown table " + table);
+
+      reader row_reader(rows, rows + rows_size);
+      for (uint32_t i = 0; i < row_count; ++i) {
+         out << "{\"table\":\"" << table << "\",\"scope\":\"" << scope << '"';
+         for (const auto& f : schema->second) {
+            out << ",\"" << f.name << "\":";
+            write_field(out, row_reader, f.type);
+         }
+         out << "}\n";
+      }
+      if (!row_reader.empty()) throw std::runtime_error("trailing bytes in " + table + " page");
+
+      cursors[table + "@" + scope] = more ? std::to_string(next_cursor) : "done";
+      return row_count;
+   }
+
+   std::vector<char> hex_to_bytes(const std::string& hex) {
+      auto nibble = [](char c) -> int {
+         if (c >= '0' && c <= '9') return c - '0';
+         if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+         if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+         throw std::runtime_error("invalid hex character");
+      };
+      if (hex.size() % 2) throw std::runtime_error("odd number of hex digits");
+
+      std::vector<char> bytes(hex.size() / 2);
+      for (std::size_t i = 0; i < bytes.size(); ++i) {
+         bytes[i] = char((nibble(hex[2 * i]) << 4) | nibble(hex[2 * i + 1]));
+      }
+      return bytes;
+   }
+
+   uint64_t decode_buffer(const std::vector<char>& bytes, std::ostream& out, std::map<std::string, std::string>& cursors) {
+      uint64_t rows = 0;
+      reader in(bytes.data(), bytes.data() + bytes.size());
+      while (!in.empty()) rows += decode_page(in, out, cursors);
+      return rows;
+   }
+
+}
+
+int main(int argc, char** argv) {
+   bool binary = false;
+   std::vector<std::string> files;
+   for (int i = 1; i < argc; ++i) {
+      if (std::strcmp(argv[i], "--binary") == 0) binary = true;
+      else files.emplace_back(argv[i]);
+   }
+   if (files.empty()) {
+      std::cerr << "usage: " << argv[0] << " [--binary] file...\n";
+      return 2;
+   }
+
+   std::ios::sync_with_stdio(false);
+   std::map<std::string, std::string> cursors;
+   uint64_t rows = 0;
+
+   try {
+      for (const auto& path : files) {
+         std::ifstream file(path, std::ios::binary);
+         if (!file) throw std::runtime_error("cannot open " + path);
+
+         if (binary) {
+            std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            rows += decode_buffer(bytes, std::cout, cursors);
+            continue;
+         }
+
+         std::string line;
+         while (std::getline(file, line)) {
+            std::string hex;
+            for (char c : line) {
+               if (c != ' ' && c != '\t' && c != '\r' && c != '"') hex.push_back(c);
+            }
+            if (!hex.empty()) rows += decode_buffer(hex_to_bytes(hex), std::cout, cursors);
+         }
+      }
+   } catch (const std::exception& e) {
+      std::cerr << "error: " << e.what() << '\n';
+      return 1;
+   }
+
+   for (const auto& [table, cursor] : cursors) {
+      std::cerr << table << " next_cursor=" << cursor << '\n';
+   }
+   std::cerr << rows << " rows decoded\n";
+   return 0;
+}